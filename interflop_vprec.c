@@ -38,6 +38,7 @@
 #include "interflop-stdlib/interflop.h"
 #include "interflop-stdlib/iostream/logger.h"
 #include "interflop_vprec.h"
+#include "interflop_vprec_fork.h"
 #include "interflop_vprec_function_instrumentation.h"
 
 static const char key_prec_b32_str[] = "precision-binary32";
@@ -660,6 +661,25 @@ void INTERFLOP_VPREC_API(exit_function)(interflop_function_stack_t *stack,
   _vfi_exit_function(stack, context, nb_args, ap);
 }
 
+// Same as enter_function with arguments described by a static array of
+// descriptors generated once per call site and an array of their addresses.
+// Not part of the interflop interface, called directly by the instrumentation
+void INTERFLOP_VPREC_API(enter_function_desc)(
+    interflop_function_stack_t *stack, void *context, int nb_args,
+    const _vfi_arg_desc_t *descs, void **values) {
+  _vfi_enter_function_desc(stack, context, nb_args, descs, values);
+}
+
+// Same as exit_function with arguments described by a static array of
+// descriptors generated once per call site and an array of their addresses.
+// Not part of the interflop interface, called directly by the instrumentation
+void INTERFLOP_VPREC_API(exit_function_desc)(interflop_function_stack_t *stack,
+                                             void *context, int nb_args,
+                                             const _vfi_arg_desc_t *descs,
+                                             void **values) {
+  _vfi_exit_function_desc(stack, context, nb_args, descs, values);
+}
+
 /************************* FPHOOKS FUNCTIONS *************************
  * These functions correspond to those inserted into the source code
  * during source to source compilation and are replacement to floating
@@ -722,6 +742,10 @@ void INTERFLOP_VPREC_API(fma_double)(double a, double b, double c, double *res,
 void INTERFLOP_VPREC_API(user_call)(void *context, interflop_call_id id,
                                     va_list ap) {
   vprec_context_t *ctx = (vprec_context_t *)context;
+  if ((int)id == VPREC_USER_CALL_FORK) {
+    _vprec_fork_explore(vprecfork_user_call, ctx);
+    return;
+  }
   switch (id) {
   case INTERFLOP_SET_PRECISION_BINARY32:
     _set_vprec_precision_binary32(va_arg(ap, int), ctx);
@@ -778,6 +802,7 @@ static struct argp_option options[] = {
 static error_t parse_opt(int key, char *arg, struct argp_state *state) {
   vprec_context_t *ctx = (vprec_context_t *)state->input;
   state->child_inputs[0] = ctx;
+  state->child_inputs[1] = ctx;
   char *endptr;
   int val = -1;
   int precision = 0;
@@ -950,7 +975,9 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
 }
 
 static struct argp_child argpc[] = {
-    {&vfi_argp, 0, "vprec function instrumentation", 0}, {0}};
+    {&vfi_argp, 0, "vprec function instrumentation", 0},
+    {&fork_argp, 0, "vprec fork exploration", 0},
+    {0}};
 
 static struct argp argp = {options, parse_opt, "", "", argpc, NULL, NULL};
 
@@ -959,6 +986,7 @@ void _vprec_alloc_context(void **context) {
   vprec_context_t *ctx =
       (vprec_context_t *)interflop_malloc(sizeof(vprec_context_t));
   _vfi_alloc_context(ctx);
+  _vprec_fork_alloc_context(ctx);
   *context = ctx;
 }
 
@@ -975,6 +1003,7 @@ static void init_context(vprec_context_t *ctx) {
   ctx->daz = false;
   ctx->ftz = false;
   _vfi_init_context(ctx);
+  _vprec_fork_init_context(ctx);
 }
 
 static void print_information_header(void *context) {
@@ -1001,6 +1030,7 @@ static void print_information_header(void *context) {
   logger_info("\t%s = %s\n", key_daz_str, ctx->daz ? "true" : "false");
   logger_info("\t%s = %s\n", key_ftz_str, ctx->ftz ? "true" : "false");
   _vfi_print_information_header(context);
+  _vprec_fork_print_information_header(context);
 }
 
 void INTERFLOP_VPREC_API(finalize)(void *context) {
@@ -1090,6 +1120,9 @@ struct interflop_backend_interface_t INTERFLOP_VPREC_API(init)(void *context) {
     interflop_finalize : INTERFLOP_VPREC_API(finalize)
   };
 
+  /* explore the variants from the initialized state if requested */
+  _vprec_fork_explore(vprecfork_init, ctx);
+
   return interflop_backend_vprec;
 }
 
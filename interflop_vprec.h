@@ -24,6 +24,7 @@
 #include "common/vprec_tools.h"
 #include "interflop-stdlib/common/float_const.h"
 #include "interflop-stdlib/iostream/logger.h"
+#include "interflop_vprec_fork.h"
 #include "interflop_vprec_function_instrumentation.h"
 
 #define INTERFLOP_VPREC_API(name) interflop_vprec_##name
@@ -62,6 +63,24 @@ typedef enum {
   KEY_OUTPUT_FILE,
   KEY_LOG_FILE,
   KEY_PRESET,
+  KEY_FORK_VARIANTS,
+  KEY_FORK_AT,
+  KEY_FORK_JOBS,
+  KEY_INSTRUMENT_THREADS,
+  KEY_INSTRUMENT_THRESHOLD,
+  KEY_INSTRUMENT_SAMPLE,
+  KEY_INSTRUMENT_SAMPLE_WARMUP,
+  KEY_INSTRUMENT_SAMPLE_RANDOM,
+  KEY_INSTRUMENT_NO_RANGES,
+  KEY_LOG_FORMAT,
+  KEY_LOG_FUNCTIONS,
+  KEY_LOG_MAX_DEPTH,
+  KEY_LOG_MAX_CALLS,
+  KEY_LOG_MAX_ELEMENTS,
+  KEY_CHECKPOINT_INTERVAL,
+  KEY_CHECKPOINT_CALLS,
+  KEY_CHECKPOINT_SIGNAL,
+  KEY_INPUT_SHARED,
   KEY_MODE = 'm',
   KEY_ERR_MODE = 'e',
   KEY_INSTRUMENT = 'i',
@@ -130,6 +149,8 @@ typedef enum {
 typedef struct {
   /* structure holding vprec function instrumentation variables */
   t_context_vfi *vfi;
+  /* structure holding vprec fork exploration variables */
+  t_context_fork *fork;
   /* arithmetic variables */
   int binary32_precision;
   int binary32_range;
@@ -165,6 +186,7 @@ float _vprec_round_binary32(float a, char is_input, void *context,
 double _vprec_round_binary64(double a, char is_input, void *context,
                              int binary64_range, int binary64_precision);
 extern struct argp vfi_argp;
+extern struct argp fork_argp;
 
 const char *get_vprec_mode_name(vprec_mode mode);
 
@@ -206,6 +228,13 @@ void INTERFLOP_VPREC_API(enter_function)(interflop_function_stack_t *stack,
                                          va_list ap);
 void INTERFLOP_VPREC_API(exit_function)(interflop_function_stack_t *stack,
                                         void *context, int nb_args, va_list ap);
+void INTERFLOP_VPREC_API(enter_function_desc)(
+    interflop_function_stack_t *stack, void *context, int nb_args,
+    const _vfi_arg_desc_t *descs, void **values);
+void INTERFLOP_VPREC_API(exit_function_desc)(interflop_function_stack_t *stack,
+                                             void *context, int nb_args,
+                                             const _vfi_arg_desc_t *descs,
+                                             void **values);
 
 void INTERFLOP_VPREC_API(user_call)(void *context, interflop_call_id id,
                                     va_list ap);
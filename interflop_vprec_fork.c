@@ -0,0 +1,349 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#include <argp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "interflop-stdlib/interflop.h"
+#include "interflop-stdlib/interflop_stdlib.h"
+#include "interflop-stdlib/iostream/logger.h"
+#include "interflop_vprec.h"
+#include "interflop_vprec_fork.h"
+#include "interflop_vprec_function_instrumentation.h"
+#include "interflop_vprec_os.h"
+
+/******************** VPREC FORK EXPLORATION ****************************
+ * The following set of functions is used to explore several precision
+ * configurations from a single warm state. At the fork point (after init
+ * or at a user_call), the process forks one child per variant listed in
+ * the variants file. Each child shares the already initialized memory of
+ * the parent copy-on-write, applies its own backend options and writes
+ * its own profile and log. The parent only supervises the children and
+ * exits once all of them are done.
+ *************************************************************************/
+
+/* fork points' names */
+static const char *VPREC_FORK_POINT_STR[] = {[vprecfork_init] = "init",
+                                             [vprecfork_user_call] =
+                                                 "user-call"};
+
+static const char key_fork_variants_str[] = "fork-variants";
+static const char key_fork_at_str[] = "fork-at";
+static const char key_fork_jobs_str[] = "fork-jobs";
+
+/* environment variable giving the variant index to the children */
+static const char fork_variant_env[] = "VPREC_FORK_VARIANT";
+
+/* Setter functions for variables */
+
+void _set_vprec_fork_variants_file(const char *variants_file, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->fork->variants_file = variants_file;
+}
+
+void _set_vprec_fork_point(vprec_fork_point point, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  if (point >= _vprecfork_end_) {
+    logger_error("invalid fork point provided, must be one of: "
+                 "{init, user-call}.");
+  } else {
+    ctx->fork->point = point;
+  }
+}
+
+void _set_vprec_fork_jobs(int jobs, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->fork->jobs = jobs;
+}
+
+/* Argument parser functions */
+
+static error_t parse_opt(int key, char *arg, struct argp_state *state) {
+  vprec_context_t *ctx = (vprec_context_t *)state->input;
+  char *endptr;
+  int error = 0;
+  long val = 0;
+
+  switch (key) {
+  case KEY_FORK_VARIANTS:
+    /* variants file */
+    _set_vprec_fork_variants_file(arg, ctx);
+    break;
+  case KEY_FORK_AT:
+    /* fork point */
+    if (interflop_strcasecmp(VPREC_FORK_POINT_STR[vprecfork_init], arg) == 0) {
+      _set_vprec_fork_point(vprecfork_init, ctx);
+    } else if (interflop_strcasecmp(VPREC_FORK_POINT_STR[vprecfork_user_call],
+                                    arg) == 0) {
+      _set_vprec_fork_point(vprecfork_user_call, ctx);
+    } else {
+      logger_error("--%s invalid value provided, must be one of: "
+                   "{init, user-call}.",
+                   key_fork_at_str);
+    }
+    break;
+  case KEY_FORK_JOBS:
+    /* number of concurrent children */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 1) {
+      logger_error("--%s invalid value provided, must be a "
+                   "positive integer.",
+                   key_fork_jobs_str);
+    } else {
+      _set_vprec_fork_jobs(val, ctx);
+    }
+    break;
+  default:
+    return ARGP_ERR_UNKNOWN;
+  }
+  return 0;
+}
+
+static struct argp_option options[] = {
+    {key_fork_variants_str, KEY_FORK_VARIANTS, "VARIANTS", 0,
+     "file with one set of backend options per line; a child process is "
+     "forked for each line",
+     0},
+    {key_fork_at_str, KEY_FORK_AT, "POINT", 0,
+     "select where to fork among {init, user-call}", 0},
+    {key_fork_jobs_str, KEY_FORK_JOBS, "JOBS", 0,
+     "maximum number of children running at the same time "
+     "(default: number of online cores)",
+     0},
+    {0}};
+
+struct argp fork_argp = {options, parse_opt, "", "", NULL, NULL, NULL};
+
+void _vprec_fork_print_information_header(void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  logger_info("\t%s = %s\n", key_fork_variants_str,
+              ctx->fork->variants_file);
+  logger_info("\t%s = %s\n", key_fork_at_str,
+              VPREC_FORK_POINT_STR[ctx->fork->point]);
+  logger_info("\t%s = %d\n", key_fork_jobs_str, ctx->fork->jobs);
+}
+
+/* allocate the context */
+void _vprec_fork_alloc_context(void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->fork = (t_context_fork *)interflop_malloc(sizeof(t_context_fork));
+}
+
+/* initialize the context */
+void _vprec_fork_init_context(void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->fork->variants_file = NULL;
+  ctx->fork->point = VPREC_FORK_POINT_DEFAULT;
+  ctx->fork->jobs = 0;
+  ctx->fork->variant = -1;
+  ctx->fork->done = false;
+}
+
+/* Core functions */
+
+/* return a copy of line without the trailing newline, or NULL if the line */
+/* is empty or a comment */
+static char *_vprec_fork_scan_variant(const char *line) {
+  while (*line == ' ' || *line == '\t')
+    line++;
+  if (*line == '\0' || *line == '\n' || *line == '#')
+    return NULL;
+
+  size_t len = strlen(line);
+  char *variant = (char *)interflop_malloc(sizeof(char) * (len + 1));
+  interflop_strcpy(variant, line);
+  if (variant[len - 1] == '\n')
+    variant[len - 1] = '\0';
+  return variant;
+}
+
+/* read the variants file, return the number of variants */
+static int _vprec_fork_read_variants(vprec_context_t *ctx, char ***variants) {
+  int error = 0;
+  File *f = interflop_fopen(ctx->fork->variants_file, "r", &error);
+  if (f == NULL) {
+    logger_error("Variants file can't be found: %s",
+                 interflop_strerror(error));
+    return 0;
+  }
+
+  int capacity = 16;
+  int nb_variants = 0;
+  *variants = (char **)interflop_malloc(sizeof(char *) * capacity);
+
+  char line[VPREC_FORK_LINE_MAX];
+  int line_number = 0;
+  while (interflop_fgets(line, VPREC_FORK_LINE_MAX, f) != NULL) {
+    line_number++;
+    /* a full buffer without newline is the start of a longer line */
+    size_t len = strlen(line);
+    if (len == VPREC_FORK_LINE_MAX - 1 && line[len - 1] != '\n') {
+      logger_error("Variants file %s: line %d is longer than %d characters",
+                   ctx->fork->variants_file, line_number,
+                   VPREC_FORK_LINE_MAX - 2);
+    }
+    char *variant = _vprec_fork_scan_variant(line);
+    if (variant == NULL)
+      continue;
+    if (nb_variants == capacity) {
+      char **grown = (char **)interflop_malloc(sizeof(char *) * capacity * 2);
+      for (int i = 0; i < nb_variants; i++)
+        grown[i] = (*variants)[i];
+      interflop_free(*variants);
+      *variants = grown;
+      capacity *= 2;
+    }
+    (*variants)[nb_variants++] = variant;
+  }
+
+  interflop_fclose(f);
+  return nb_variants;
+}
+
+/* return "<name>.<variant>" */
+static const char *_vprec_fork_suffix_name(const char *name, int variant) {
+  char *suffixed = (char *)interflop_malloc(sizeof(char) * (strlen(name) + 16));
+  interflop_sprintf(suffixed, "%s.%d", name, variant);
+  return suffixed;
+}
+
+/* apply the backend options of the variant in the child process */
+static void _vprec_fork_apply_variant(vprec_context_t *ctx, int variant,
+                                      char *options) {
+  const char *input_file = ctx->vfi->vprec_input_file;
+  const char *output_file = ctx->vfi->vprec_output_file;
+  const char *log_file = ctx->vfi->vprec_log_file;
+
+  ctx->fork->variant = variant;
+
+  char variant_str[16];
+  interflop_sprintf(variant_str, "%d", variant);
+  int error = 0;
+  if (!_vprec_os_setenv(fork_variant_env, variant_str, &error)) {
+    logger_warning("%s can't be set: %s\n", fork_variant_env,
+                   interflop_strerror(error));
+  }
+
+  /* split the line into an argv vector and parse it as backend options: */
+  /* "vprec", at most one token every two characters and NULL */
+  char *argv[VPREC_FORK_LINE_MAX / 2 + 2];
+  int argc = 0;
+  char *saveptr;
+  argv[argc++] = "vprec";
+  char *token = interflop_strtok_r(options, " \t", &saveptr);
+  while (token && argc < VPREC_FORK_LINE_MAX / 2 + 1) {
+    argv[argc++] = token;
+    token = interflop_strtok_r(NULL, " \t", &saveptr);
+  }
+  argv[argc] = NULL;
+  INTERFLOP_VPREC_API(CLI)(argc, argv, ctx);
+
+  /* children must not overwrite each other's outputs */
+  if (ctx->vfi->vprec_output_file != NULL &&
+      ctx->vfi->vprec_output_file == output_file) {
+    ctx->vfi->vprec_output_file = _vprec_fork_suffix_name(output_file, variant);
+  }
+  if (ctx->vfi->vprec_log_file != NULL &&
+      ctx->vfi->vprec_log_file == log_file) {
+    ctx->vfi->vprec_log_file = _vprec_fork_suffix_name(log_file, variant);
+  }
+
+  _vfi_reload(ctx, ctx->vfi->vprec_input_file != input_file,
+              ctx->vfi->vprec_log_file != log_file);
+
+  logger_info("variant %d (pid %d): %s\n", variant, _vprec_os_getpid(),
+              options);
+}
+
+/* wait for one child, return 1 if it failed, 0 otherwise */
+static int _vprec_fork_wait_child(void) {
+  int status = 0;
+  int error = 0;
+  IBool success = false;
+  pid_t pid = _vprec_os_wait_child(&success, &status, &error);
+  if (pid < 0) {
+    logger_error("waitpid failed: %s", interflop_strerror(error));
+    return 1;
+  }
+  if (success) {
+    return 0;
+  }
+  logger_warning("variant child %d failed (status %d)\n", pid, status);
+  return 1;
+}
+
+void _vprec_fork_explore(vprec_fork_point point, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+
+  if (ctx->fork->variants_file == NULL || ctx->fork->done ||
+      ctx->fork->point != point) {
+    return;
+  }
+  ctx->fork->done = true;
+
+  char **variants = NULL;
+  int nb_variants = _vprec_fork_read_variants(ctx, &variants);
+
+  int jobs = ctx->fork->jobs;
+  if (jobs <= 0) {
+    jobs = _vprec_os_nb_cores();
+  }
+
+  /* flush buffered outputs so that children do not write them again */
+  _vfi_flush_log(ctx);
+  _vprec_os_flush_streams();
+
+  int running = 0;
+  int failures = 0;
+  for (int i = 0; i < nb_variants; i++) {
+    if (running == jobs) {
+      failures += _vprec_fork_wait_child();
+      running--;
+    }
+
+    int error = 0;
+    pid_t pid = _vprec_os_fork(&error);
+    if (pid < 0) {
+      logger_error("fork failed: %s", interflop_strerror(error));
+    } else if (pid == 0) {
+      /* child: apply the variant and resume the application */
+      char *options = variants[i];
+      for (int j = 0; j < nb_variants; j++)
+        if (j != i)
+          interflop_free(variants[j]);
+      interflop_free(variants);
+      _vprec_fork_apply_variant(ctx, i, options);
+      return;
+    }
+    running++;
+  }
+
+  while (running > 0) {
+    failures += _vprec_fork_wait_child();
+    running--;
+  }
+
+  logger_info("%d variants explored, %d failed\n", nb_variants, failures);
+
+  /* the parent does not produce any profile of its own */
+  ctx->vfi->vprec_output_file = NULL;
+  interflop_exit(failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
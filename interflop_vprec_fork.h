@@ -0,0 +1,69 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#ifndef __INTERFLOP_VPREC_FORK_H__
+#define __INTERFLOP_VPREC_FORK_H__
+
+#include "interflop-stdlib/interflop.h"
+#include "interflop-stdlib/interflop_stdlib.h"
+
+/* define the points where the exploration forks */
+typedef enum {
+  vprecfork_init,
+  vprecfork_user_call,
+  _vprecfork_end_
+} vprec_fork_point;
+
+/* default fork point */
+#define VPREC_FORK_POINT_DEFAULT vprecfork_init
+
+/* user_call id marking the fork point in the application */
+#define VPREC_USER_CALL_FORK 0x7670
+
+/* maximum length of a variant line */
+#define VPREC_FORK_LINE_MAX 4096
+
+typedef struct {
+  /* file with one variant (list of backend options) per line */
+  const char *variants_file;
+  /* where to fork */
+  vprec_fork_point point;
+  /* maximum number of children running at the same time */
+  int jobs;
+  /* index of the variant applied by this process, -1 if not forked */
+  int variant;
+  /* true once the exploration has been run */
+  IBool done;
+} t_context_fork;
+
+extern struct argp fork_argp;
+
+void _vprec_fork_print_information_header(void *context);
+
+/* Fork exploration context allocator */
+void _vprec_fork_alloc_context(void *context);
+
+/* Fork exploration context initializer */
+void _vprec_fork_init_context(void *context);
+
+/* Fork one child per variant if the exploration is set to fork at point */
+void _vprec_fork_explore(vprec_fork_point point, void *context);
+
+#endif /* __INTERFLOP_VPREC_FORK_H__ */
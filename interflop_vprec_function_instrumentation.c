@@ -19,13 +19,26 @@
  ****************************************************************************/
 
 #include <argp.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "common/vprec_tools.h"
+#include "interflop-stdlib/common/float_struct.h"
 #include "interflop-stdlib/hashmap/vfc_hashmap.h"
 #include "interflop-stdlib/interflop.h"
 #include "interflop-stdlib/interflop_stdlib.h"
 #include "interflop_vprec.h"
 #include "interflop_vprec_function_instrumentation.h"
+#include "interflop_vprec_os.h"
+#include "interflop_vprec_profile.h"
 
 /******************** VPREC FUNCTIONS INSTRUMENTATION (VFI) **************
  * The following set of functions is used to apply vprec on instrumented
@@ -41,29 +54,38 @@ static const char *VPREC_INST_MODE_STR[] = {[vprecinst_arg] = "arguments",
                                             [vprecinst_all] = "all",
                                             [vprecinst_none] = "none"};
 
+/* log formats' names */
+static const char *VPREC_LOG_FORMAT_STR[] = {
+    [vfilog_format_text] = "text", [vfilog_format_binary] = "binary"};
+
 static const char key_instrument_str[] = "instrument";
 static const char key_input_file_str[] = "prec-input-file";
+static const char key_input_shared_str[] = "prec-input-shared";
 static const char key_output_file_str[] = "prec-output-file";
 static const char key_log_file_str[] = "prec-log-file";
-
-#define STRING_BUFF 256
-
-#define INIT_STRING(A, N)                                                      \
-  for (int i = 0; i < N; i++)                                                  \
-    A[i] = (char *)interflop_malloc(sizeof(char) * STRING_BUFF);
-
-#define FREE_STRING(A, N)                                                      \
-  for (int i = 0; i < N; i++)                                                  \
-    if (A[i])                                                                  \
-      interflop_free(A[i]);
-
-const int elt_to_read_header = 12;
-const int elt_to_read_inputs = 7;
-const int elt_to_read_outputs = 7;
-
-char *tokens_header[12];
-char *tokens_inputs[7];
-char *tokens_outputs[7];
+static const char key_log_format_str[] = "prec-log-format";
+static const char key_instrument_threads_str[] = "instrument-threads";
+static const char key_instrument_threshold_str[] =
+    "instrument-parallel-threshold";
+static const char key_instrument_sample_str[] = "instrument-sample";
+static const char key_instrument_sample_warmup_str[] =
+    "instrument-sample-warmup";
+static const char key_instrument_sample_random_str[] =
+    "instrument-sample-random";
+static const char key_instrument_no_ranges_str[] = "instrument-no-ranges";
+static const char key_log_functions_str[] = "prec-log-functions";
+static const char key_log_max_depth_str[] = "prec-log-max-depth";
+static const char key_log_max_calls_str[] = "prec-log-max-calls";
+static const char key_log_max_elements_str[] = "prec-log-max-elements";
+static const char key_checkpoint_interval_str[] = "prec-checkpoint-interval";
+static const char key_checkpoint_calls_str[] = "prec-checkpoint-calls";
+static const char key_checkpoint_signal_str[] = "prec-checkpoint-signal";
+
+#define STRING_BUFF 4096
+
+#define elt_to_read_header 12
+/* input and output lines have the same fields */
+#define elt_to_read_inputs 8
 
 static File *_vprec_log_file = Null;
 
@@ -74,6 +96,11 @@ void _set_vprec_input_file(const char *input_file, void *context) {
   ctx->vfi->vprec_input_file = input_file;
 }
 
+void _set_vprec_input_shared(IBool shared, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->input_shared = shared;
+}
+
 void _set_vprec_output_file(const char *output_file, void *context) {
   vprec_context_t *ctx = (vprec_context_t *)context;
   ctx->vfi->vprec_output_file = output_file;
@@ -84,6 +111,11 @@ void _set_vprec_log_file(const char *log_file, void *context) {
   ctx->vfi->vprec_log_file = log_file;
 }
 
+void _set_vprec_log_format(_vfi_log_format_t format, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->vprec_log_format = format;
+}
+
 void _set_vprec_inst_mode(vprec_inst_mode mode, void *context) {
   vprec_context_t *ctx = (vprec_context_t *)context;
   if (mode >= _vprecinst_end_) {
@@ -94,8 +126,66 @@ void _set_vprec_inst_mode(vprec_inst_mode mode, void *context) {
   }
 }
 
+void _set_vprec_inst_threads(int nb_threads, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->nb_threads = nb_threads;
+}
+
+void _set_vprec_inst_threshold(ISize_t threshold, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->parallel_threshold = threshold;
+}
+
+void _set_vprec_inst_sample(int period, int warmup, IBool random,
+                            void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->sample_period = period;
+  ctx->vfi->sample_warmup = warmup;
+  ctx->vfi->sample_random = random;
+}
+
+void _set_vprec_inst_ranges(IBool track_ranges, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->track_ranges = track_ranges;
+}
+
+void _set_vprec_log_functions(const char *functions, void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->vprec_log_functions = functions;
+}
+
+void _set_vprec_log_limits(int max_depth, int max_calls, int max_elements,
+                           void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->log_max_depth = max_depth;
+  ctx->vfi->log_max_calls = max_calls;
+  ctx->vfi->log_max_elements = max_elements;
+}
+
+void _set_vprec_checkpoint(int interval, int calls, IBool signal,
+                           void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->checkpoint_interval = interval;
+  ctx->vfi->checkpoint_calls = calls;
+  ctx->vfi->checkpoint_signal = signal;
+}
+
 /* Argument parser functions */
 
+void _parse_key_log_format(char *arg, vprec_context_t *ctx) {
+  if (interflop_strcasecmp(VPREC_LOG_FORMAT_STR[vfilog_format_text], arg) ==
+      0) {
+    _set_vprec_log_format(vfilog_format_text, ctx);
+  } else if (interflop_strcasecmp(VPREC_LOG_FORMAT_STR[vfilog_format_binary],
+                                  arg) == 0) {
+    _set_vprec_log_format(vfilog_format_binary, ctx);
+  } else {
+    logger_error("--%s invalid value provided, must be one of: "
+                 "{text, binary}.",
+                 key_log_format_str);
+  }
+}
+
 void _parse_key_instrument(char *arg, vprec_context_t *ctx) {
   /* instrumentation mode */
   if (interflop_strcasecmp(VPREC_INST_MODE_STR[vprecinst_arg], arg) == 0) {
@@ -118,6 +208,9 @@ void _parse_key_instrument(char *arg, vprec_context_t *ctx) {
 
 static error_t parse_opt(int key, char *arg, struct argp_state *state) {
   vprec_context_t *ctx = (vprec_context_t *)state->input;
+  char *endptr;
+  int error = 0;
+  long val = -1;
   switch (key) {
   case KEY_INPUT_FILE:
     /* input file */
@@ -131,9 +224,140 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
     /* log file */
     _set_vprec_log_file(arg, ctx);
     break;
+  case KEY_LOG_FORMAT:
+    _parse_key_log_format(arg, ctx);
+    break;
   case KEY_INSTRUMENT:
     _parse_key_instrument(arg, ctx);
     break;
+  case KEY_INSTRUMENT_THREADS:
+    /* threads processing large pointer arguments */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 1) {
+      logger_error("--%s invalid value provided, must be a "
+                   "positive integer.",
+                   key_instrument_threads_str);
+    } else {
+      _set_vprec_inst_threads(val, ctx);
+    }
+    break;
+  case KEY_INSTRUMENT_THRESHOLD:
+    /* size above which pointer arguments are split across threads */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 1) {
+      logger_error("--%s invalid value provided, must be a "
+                   "positive integer.",
+                   key_instrument_threshold_str);
+    } else {
+      _set_vprec_inst_threshold(val, ctx);
+    }
+    break;
+  case KEY_INSTRUMENT_SAMPLE:
+    /* trace one call out of val */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 1 || val > INT_MAX) {
+      logger_error("--%s invalid value provided, must be a "
+                   "positive integer.",
+                   key_instrument_sample_str);
+    } else {
+      _set_vprec_inst_sample(val, ctx->vfi->sample_warmup,
+                             ctx->vfi->sample_random, ctx);
+    }
+    break;
+  case KEY_INSTRUMENT_SAMPLE_WARMUP:
+    /* trace the first val calls */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 0 || val > INT_MAX) {
+      logger_error("--%s invalid value provided, must be a "
+                   "non-negative integer.",
+                   key_instrument_sample_warmup_str);
+    } else {
+      _set_vprec_inst_sample(ctx->vfi->sample_period, val,
+                             ctx->vfi->sample_random, ctx);
+    }
+    break;
+  case KEY_INSTRUMENT_SAMPLE_RANDOM:
+    /* draw the traced calls at random */
+    _set_vprec_inst_sample(ctx->vfi->sample_period, ctx->vfi->sample_warmup,
+                           true, ctx);
+    break;
+  case KEY_INSTRUMENT_NO_RANGES:
+    /* leave the argument ranges to vfi_log_replay.py */
+    _set_vprec_inst_ranges(false, ctx);
+    break;
+  case KEY_LOG_FUNCTIONS:
+    /* regular expression of the logged functions */
+    _set_vprec_log_functions(arg, ctx);
+    break;
+  case KEY_LOG_MAX_DEPTH:
+    /* log the calls nested in less than val instrumented calls */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 1 || val > INT_MAX) {
+      logger_error("--%s invalid value provided, must be a "
+                   "positive integer.",
+                   key_log_max_depth_str);
+    } else {
+      _set_vprec_log_limits(val, ctx->vfi->log_max_calls,
+                            ctx->vfi->log_max_elements, ctx);
+    }
+    break;
+  case KEY_LOG_MAX_CALLS:
+    /* log the first val calls of each function */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 1 || val > INT_MAX) {
+      logger_error("--%s invalid value provided, must be a "
+                   "positive integer.",
+                   key_log_max_calls_str);
+    } else {
+      _set_vprec_log_limits(ctx->vfi->log_max_depth, val,
+                            ctx->vfi->log_max_elements, ctx);
+    }
+    break;
+  case KEY_LOG_MAX_ELEMENTS:
+    /* log the first val elements of each pointer argument */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 1 || val > INT_MAX) {
+      logger_error("--%s invalid value provided, must be a "
+                   "positive integer.",
+                   key_log_max_elements_str);
+    } else {
+      _set_vprec_log_limits(ctx->vfi->log_max_depth, ctx->vfi->log_max_calls,
+                            val, ctx);
+    }
+    break;
+  case KEY_CHECKPOINT_INTERVAL:
+    /* write the output profile every val seconds */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 1 || val > INT_MAX) {
+      logger_error("--%s invalid value provided, must be a "
+                   "positive integer.",
+                   key_checkpoint_interval_str);
+    } else {
+      _set_vprec_checkpoint(val, ctx->vfi->checkpoint_calls,
+                            ctx->vfi->checkpoint_signal, ctx);
+    }
+    break;
+  case KEY_CHECKPOINT_CALLS:
+    /* write the output profile every val calls of the process */
+    val = interflop_strtol(arg, &endptr, &error);
+    if (error != 0 || val < 1 || val > INT_MAX) {
+      logger_error("--%s invalid value provided, must be a "
+                   "positive integer.",
+                   key_checkpoint_calls_str);
+    } else {
+      _set_vprec_checkpoint(ctx->vfi->checkpoint_interval, val,
+                            ctx->vfi->checkpoint_signal, ctx);
+    }
+    break;
+  case KEY_CHECKPOINT_SIGNAL:
+    /* write the output profile on SIGUSR1 */
+    _set_vprec_checkpoint(ctx->vfi->checkpoint_interval,
+                          ctx->vfi->checkpoint_calls, true, ctx);
+    break;
+  case KEY_INPUT_SHARED:
+    /* share the text input profile between the processes of the node */
+    _set_vprec_input_shared(true, ctx);
+    break;
 
   default:
     return ARGP_ERR_UNKNOWN;
@@ -144,13 +368,76 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
 static struct argp_option options[] = {
     {key_input_file_str, KEY_INPUT_FILE, "INPUT", 0,
      "input file with the precision configuration to use", 0},
+    {key_input_shared_str, KEY_INPUT_SHARED, 0, 0,
+     "parse a text input file once per node: the first process writes it to "
+     "shared memory and the others map it read-only. The segment is removed "
+     "by the last process, a run that crashed leaves it in /dev/shm where "
+     "the next runs with the same file reuse it",
+     0},
     {key_output_file_str, KEY_OUTPUT_FILE, "OUTPUT", 0,
-     "output file where the precision profile is written", 0},
+     "output file where the precision profile is written, %r and %p are "
+     "replaced by the MPI rank and the pid of the process",
+     0},
     {key_log_file_str, KEY_LOG_FILE, "LOG", 0,
      "log file where input/output informations are written", 0},
+    {key_log_format_str, KEY_LOG_FORMAT, "FORMAT", 0,
+     "format of the log file among {text, binary}, binary logs are decoded "
+     "with vfi_log_decode.py (default: text)",
+     0},
+    {key_log_functions_str, KEY_LOG_FUNCTIONS, "REGEX", 0,
+     "log only the functions whose id matches the POSIX extended regular "
+     "expression REGEX, e.g. 'dot|axpy' (default: all functions)",
+     0},
+    {key_log_max_depth_str, KEY_LOG_MAX_DEPTH, "DEPTH", 0,
+     "log only the calls nested in less than DEPTH instrumented calls "
+     "(default: no limit)",
+     0},
+    {key_log_max_calls_str, KEY_LOG_MAX_CALLS, "CALLS", 0,
+     "log only the first CALLS logged calls of each function "
+     "(default: no limit)",
+     0},
+    {key_log_max_elements_str, KEY_LOG_MAX_ELEMENTS, "ELEMENTS", 0,
+     "log only the first ELEMENTS elements of each pointer argument, the "
+     "other elements are still rounded (default: no limit)",
+     0},
     {key_instrument_str, KEY_INSTRUMENT, "INSTRUMENTATION", 0,
      "select VPREC instrumentation mode among {arguments, operations, full}",
      0},
+    {key_instrument_threads_str, KEY_INSTRUMENT_THREADS, "THREADS", 0,
+     "number of threads rounding and scanning large pointer arguments and "
+     "parsing large text profiles (default: 1)",
+     0},
+    {key_instrument_threshold_str, KEY_INSTRUMENT_THRESHOLD, "ELEMENTS", 0,
+     "number of elements above which pointer arguments are split across "
+     "threads (default: 1048576)",
+     0},
+    {key_instrument_sample_str, KEY_INSTRUMENT_SAMPLE, "N", 0,
+     "update the argument ranges and log one call out of N of each function, "
+     "arguments and operations are rounded on every call (default: 1)",
+     0},
+    {key_instrument_sample_warmup_str, KEY_INSTRUMENT_SAMPLE_WARMUP, "CALLS", 0,
+     "trace every one of the first CALLS calls of each function before "
+     "sampling (default: 0)",
+     0},
+    {key_instrument_sample_random_str, KEY_INSTRUMENT_SAMPLE_RANDOM, 0, 0,
+     "trace each call after the warmup with probability 1/N instead of "
+     "every Nth call",
+     0},
+    {key_instrument_no_ranges_str, KEY_INSTRUMENT_NO_RANGES, 0, 0,
+     "do not update the argument ranges and histograms, arguments are still "
+     "rounded and logged. The profile is rebuilt from --prec-log-file with "
+     "vfi_log_replay.py",
+     0},
+    {key_checkpoint_interval_str, KEY_CHECKPOINT_INTERVAL, "SECONDS", 0,
+     "also write the output profile every SECONDS seconds, from a "
+     "background thread (default: only at exit)",
+     0},
+    {key_checkpoint_calls_str, KEY_CHECKPOINT_CALLS, "CALLS", 0,
+     "also write the output profile every CALLS instrumented calls of the "
+     "process (default: only at exit)",
+     0},
+    {key_checkpoint_signal_str, KEY_CHECKPOINT_SIGNAL, 0, 0,
+     "also write the output profile when the process receives SIGUSR1", 0},
     {0}};
 
 struct argp vfi_argp = {options, parse_opt, "", "", NULL, NULL, NULL};
@@ -160,517 +447,2831 @@ void _vfi_print_information_header(void *context) {
   logger_info("\t%s = %s\n", key_instrument_str,
               VPREC_INST_MODE_STR[ctx->vfi->vprec_inst_mode]);
   logger_info("\t%s = %s\n", key_input_file_str, ctx->vfi->vprec_input_file);
+  logger_info("\t%s = %s\n", key_input_shared_str,
+              ctx->vfi->input_shared ? "true" : "false");
   logger_info("\t%s = %s\n", key_output_file_str, ctx->vfi->vprec_output_file);
   logger_info("\t%s = %s\n", key_log_file_str, ctx->vfi->vprec_log_file);
+  logger_info("\t%s = %s\n", key_log_format_str,
+              VPREC_LOG_FORMAT_STR[ctx->vfi->vprec_log_format]);
+  logger_info("\t%s = %s\n", key_log_functions_str,
+              ctx->vfi->vprec_log_functions);
+  logger_info("\t%s = %d\n", key_log_max_depth_str, ctx->vfi->log_max_depth);
+  logger_info("\t%s = %d\n", key_log_max_calls_str, ctx->vfi->log_max_calls);
+  logger_info("\t%s = %d\n", key_log_max_elements_str,
+              ctx->vfi->log_max_elements);
+  logger_info("\t%s = %d\n", key_instrument_threads_str,
+              ctx->vfi->nb_threads);
+  logger_info("\t%s = %zu\n", key_instrument_threshold_str,
+              ctx->vfi->parallel_threshold);
+  logger_info("\t%s = %d\n", key_instrument_sample_str,
+              ctx->vfi->sample_period);
+  logger_info("\t%s = %d\n", key_instrument_sample_warmup_str,
+              ctx->vfi->sample_warmup);
+  logger_info("\t%s = %s\n", key_instrument_sample_random_str,
+              ctx->vfi->sample_random ? "true" : "false");
+  logger_info("\t%s = %s\n", key_instrument_no_ranges_str,
+              ctx->vfi->track_ranges ? "false" : "true");
+  logger_info("\t%s = %d\n", key_checkpoint_interval_str,
+              ctx->vfi->checkpoint_interval);
+  logger_info("\t%s = %d\n", key_checkpoint_calls_str,
+              ctx->vfi->checkpoint_calls);
+  logger_info("\t%s = %s\n", key_checkpoint_signal_str,
+              ctx->vfi->checkpoint_signal ? "true" : "false");
 }
 
-/* Core functions */
+/* Arena */
 
-// Write the hashmap in the given file
-void _vfi_write_hasmap(FILE *fout, vprec_context_t *ctx) {
-  for (size_t ii = 0; ii < ctx->vfi->map->capacity; ii++) {
-    if (get_value_at(ctx->vfi->map->items, ii) != 0 &&
-        get_value_at(ctx->vfi->map->items, ii) != 0) {
-      _vfi_t *function = (_vfi_t *)get_value_at(ctx->vfi->map->items, ii);
-
-      interflop_fprintf(
-          fout, "%s\t%hd\t%hd\t%zu\t%zu\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
-          function->id, function->isLibraryFunction,
-          function->isIntrinsicFunction, function->useFloat,
-          function->useDouble, function->OpsPrec64, function->OpsRange64,
-          function->OpsPrec32, function->OpsRange32, function->nb_input_args,
-          function->nb_output_args, function->n_calls);
-      for (int i = 0; i < function->nb_input_args; i++) {
-        interflop_fprintf(fout, "input:\t%s\t%hd\t%d\t%d\t%d\t%d\n",
-                          function->input_args[i].arg_id,
-                          function->input_args[i].data_type,
-                          function->input_args[i].mantissa_length,
-                          function->input_args[i].exponent_length,
-                          function->input_args[i].min_range,
-                          function->input_args[i].max_range);
-      }
-      for (int i = 0; i < function->nb_output_args; i++) {
-        interflop_fprintf(fout, "output:\t%s\t%hd\t%d\t%d\t%d\t%d\n",
-                          function->output_args[i].arg_id,
-                          function->output_args[i].data_type,
-                          function->output_args[i].mantissa_length,
-                          function->output_args[i].exponent_length,
-                          function->output_args[i].min_range,
-                          function->output_args[i].max_range);
-      }
-    }
-  }
+#define VFI_ARENA_CHUNK_SIZE (64 * 1024)
+#define VFI_ARENA_ALIGNMENT 16
+
+static void _vfi_arena_init(_vfi_arena_t *arena) { arena->chunks = NULL; }
+
+/* first address of the free space of chunk aligned on align */
+static inline uintptr_t _vfi_arena_free_space(_vfi_arena_chunk_t *chunk,
+                                              size_t align) {
+  uintptr_t address = (uintptr_t)(chunk->data + chunk->used);
+  return (address + align - 1) & ~(uintptr_t)(align - 1);
 }
 
-/* Helper function scanning an integer */
-/* return the integer upon success */
-/* otherwise call logger_error  */
-long _vfi_scan_int(char *token, const char *field) {
-  int error = 0;
-  char *endptr;
-  long res = interflop_strtol(token, &endptr, &error);
-  if (error != 0) {
-    logger_error("Error while reading hashmap config file (field: %s)\n",
-                 field);
+/* return size bytes aligned on align, a power of two at most */
+/* VFI_ARENA_ALIGNMENT, NULL if size is 0 */
+static void *_vfi_arena_alloc_aligned(_vfi_arena_t *arena, size_t size,
+                                      size_t align) {
+  if (size == 0)
+    return NULL;
+
+  _vfi_arena_chunk_t *chunk = arena->chunks;
+  if (chunk == NULL || _vfi_arena_free_space(chunk, align) + size >
+                           (uintptr_t)(chunk->data + chunk->size)) {
+    size_t chunk_size = size + VFI_ARENA_ALIGNMENT;
+    if (chunk_size < VFI_ARENA_CHUNK_SIZE)
+      chunk_size = VFI_ARENA_CHUNK_SIZE;
+    chunk = interflop_malloc(sizeof(_vfi_arena_chunk_t) + chunk_size);
+    chunk->next = arena->chunks;
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    arena->chunks = chunk;
   }
-  return res;
+  uintptr_t start = _vfi_arena_free_space(chunk, align);
+  chunk->used = start + size - (uintptr_t)chunk->data;
+  return (void *)start;
 }
 
-int _vfi_scan_line(FILE *fi, char **tokens) {
-  const int line_max_size = 2048;
-  char line[2048];
-  interflop_fgets(line, line_max_size, fi);
-  char *tabptr;
-  char *token = interflop_strtok_r(line, "\t", &tabptr);
-  int nb_token = 0;
-  while (token) {
-    interflop_strcpy(tokens[nb_token], token);
-    nb_token++;
-    token = interflop_strtok_r(NULL, "\t", &tabptr);
-  }
-  return nb_token;
+/* return size bytes aligned on VFI_ARENA_ALIGNMENT, NULL if size is 0 */
+static inline void *_vfi_arena_alloc(_vfi_arena_t *arena, size_t size) {
+  return _vfi_arena_alloc_aligned(arena, size, VFI_ARENA_ALIGNMENT);
 }
 
-int _vfi_scan_header(FILE *fi, _vfi_t *function_ptr) {
-  int nb_token = _vfi_scan_line(fi, tokens_header);
-  if (nb_token != elt_to_read_header) {
-    return nb_token;
+/* release all the allocations of the arena */
+static void _vfi_arena_free(_vfi_arena_t *arena) {
+  while (arena->chunks != NULL) {
+    _vfi_arena_chunk_t *next = arena->chunks->next;
+    interflop_free(arena->chunks);
+    arena->chunks = next;
   }
+}
 
-  interflop_strcpy(function_ptr->id, tokens_header[0]);
-  function_ptr->isLibraryFunction =
-      _vfi_scan_int(tokens_header[1], "isLibraryFunction");
-  function_ptr->isIntrinsicFunction =
-      _vfi_scan_int(tokens_header[2], "isIntrinsicFunction");
-  function_ptr->useFloat = _vfi_scan_int(tokens_header[3], "useFloat");
-  function_ptr->useDouble = _vfi_scan_int(tokens_header[4], "useDouble");
-  function_ptr->OpsPrec64 = _vfi_scan_int(tokens_header[5], "OpsPrec64");
-  function_ptr->OpsRange64 = _vfi_scan_int(tokens_header[6], "OpsRange64");
-  function_ptr->OpsPrec32 = _vfi_scan_int(tokens_header[7], "OpsPrec32");
-  function_ptr->OpsRange32 = _vfi_scan_int(tokens_header[8], "OpsRange32");
-  function_ptr->nb_input_args =
-      _vfi_scan_int(tokens_header[9], "nb_input_args");
-  function_ptr->nb_output_args =
-      _vfi_scan_int(tokens_header[10], "nb_output_args");
-  function_ptr->n_calls = _vfi_scan_int(tokens_header[11], "n_calls");
-
-  return nb_token;
-}
-
-int _vfi_scan_input(FILE *fi, _vfi_t *function_ptr, int arg_pos) {
-  int nb_token = _vfi_scan_line(fi, tokens_inputs);
-  _vfi_argument_data_t *arg_data = &function_ptr->input_args[arg_pos];
-
-  // tokens[0] == "input:"
-  interflop_strcpy(arg_data->arg_id, tokens_inputs[1]);
-  arg_data->data_type = _vfi_scan_int(tokens_inputs[2], "data_type");
-  arg_data->mantissa_length =
-      _vfi_scan_int(tokens_inputs[3], "mantissa_length");
-  arg_data->exponent_length =
-      _vfi_scan_int(tokens_inputs[4], "exponent_length");
-  arg_data->min_range = _vfi_scan_int(tokens_inputs[5], "min_range");
-  arg_data->max_range = _vfi_scan_int(tokens_inputs[6], "max_range");
-
-  return nb_token;
-}
-
-int _vfi_scan_output(FILE *fi, _vfi_t *function_ptr, int arg_pos) {
-  int nb_token = _vfi_scan_line(fi, tokens_outputs);
-  _vfi_argument_data_t *arg_data = &function_ptr->output_args[arg_pos];
-
-  // tokens[0] == "output:"
-  interflop_strcpy(arg_data->arg_id, tokens_outputs[1]);
-  arg_data->data_type = _vfi_scan_int(tokens_outputs[2], "data_type");
-  arg_data->mantissa_length =
-      _vfi_scan_int(tokens_outputs[3], "mantissa_length");
-  arg_data->exponent_length =
-      _vfi_scan_int(tokens_outputs[4], "exponent_length");
-  arg_data->min_range = _vfi_scan_int(tokens_outputs[5], "min_range");
-  arg_data->max_range = _vfi_scan_int(tokens_outputs[6], "max_range");
-
-  return nb_token;
+/* String pool */
+
+#define VFI_STRING_POOL_INIT_CAPACITY 1024
+
+static void _vfi_string_pool_init(_vfi_string_pool_t *pool) {
+  _vfi_arena_init(&pool->arena);
+  pool->capacity = VFI_STRING_POOL_INIT_CAPACITY;
+  pool->nb_strings = 0;
+  pool->strings = interflop_calloc(pool->capacity, sizeof(char *));
 }
 
-// Read and initialize the hashmap from the given file
-void _vfi_read_hasmap(FILE *fin, vprec_context_t *ctx) {
-  _vfi_t function;
-
-  while (_vfi_scan_header(fin, &function) == 12) {
-    // allocate space for input arguments
-    function.input_args =
-        interflop_malloc(function.nb_input_args * sizeof(_vfi_argument_data_t));
-    // allocate space for output arguments
-    function.output_args = interflop_malloc(function.nb_output_args *
-                                            sizeof(_vfi_argument_data_t));
-
-    const int elt_to_read = 7;
-    // get input arguments precision
-    for (int i = 0; i < function.nb_input_args; i++) {
-      if (_vfi_scan_input(fin, &function, i) != elt_to_read) {
-        logger_error("Can't read input arguments of %s\n", function.id);
-      }
-    }
+static void _vfi_string_pool_free(_vfi_string_pool_t *pool) {
+  _vfi_arena_free(&pool->arena);
+  interflop_free(pool->strings);
+  pool->strings = NULL;
+  pool->capacity = 0;
+  pool->nb_strings = 0;
+}
 
-    // get output arguments precision
-    for (int i = 0; i < function.nb_output_args; i++) {
-      if (_vfi_scan_output(fin, &function, i) != elt_to_read) {
-        logger_error("Can't read output arguments of %s\n", function.id);
-      }
-    }
+/* double the capacity of the set of interned strings */
+static void _vfi_string_pool_grow(_vfi_string_pool_t *pool) {
+  size_t capacity = 2 * pool->capacity;
+  const char **strings = interflop_calloc(capacity, sizeof(char *));
+  for (size_t i = 0; i < pool->capacity; i++) {
+    if (pool->strings[i] == NULL)
+      continue;
+    size_t j = _vfi_profile_hash(pool->strings[i]) & (capacity - 1);
+    while (strings[j] != NULL)
+      j = (j + 1) & (capacity - 1);
+    strings[j] = pool->strings[i];
+  }
+  interflop_free(pool->strings);
+  pool->strings = strings;
+  pool->capacity = capacity;
+}
 
-    // insert in the hashmap
-    _vfi_t *address = interflop_malloc(sizeof(_vfi_t));
-    (*address) = function;
-    vfc_hashmap_insert(ctx->vfi->map, vfc_hashmap_str_function(function.id),
-                       address);
+/* return the copy of string stored in the pool, all the calls with equal */
+/* strings return the same pointer */
+static const char *_vfi_intern(_vfi_string_pool_t *pool, const char *string) {
+  if (2 * (pool->nb_strings + 1) > pool->capacity)
+    _vfi_string_pool_grow(pool);
+
+  size_t i = _vfi_profile_hash(string) & (pool->capacity - 1);
+  while (pool->strings[i] != NULL) {
+    if (interflop_strcmp(pool->strings[i], string) == 0)
+      return pool->strings[i];
+    i = (i + 1) & (pool->capacity - 1);
   }
+  size_t len = strlen(string);
+  /* strings are read byte by byte, packing them saves the padding */
+  char *copy = _vfi_arena_alloc_aligned(&pool->arena, len + 1, 1);
+  memcpy(copy, string, len + 1);
+  pool->strings[i] = copy;
+  pool->nb_strings++;
+  return pool->strings[i];
 }
 
-// Print str in vprec_log_file with the correct offset
-#define _vfi_print_log(ctx, _vprec_str, ...)                                   \
-  ({                                                                           \
-    if (_vprec_log_file != NULL) {                                             \
-      for (size_t _vprec_d = 0; _vprec_d < ctx->vfi->vprec_log_depth;          \
-           _vprec_d++)                                                         \
-        interflop_fprintf(_vprec_log_file, "\t");                              \
-      interflop_fprintf(_vprec_log_file, _vprec_str, ##__VA_ARGS__);           \
-    }                                                                          \
-  })
+/* Core functions */
 
-/* allocate the context */
-void _vfi_alloc_context(void *context) {
-  vprec_context_t *ctx = (vprec_context_t *)context;
-  ctx->vfi = (t_context_vfi *)interflop_malloc(sizeof(t_context_vfi));
+/* true if the exponent histograms of the arguments are kept, they are */
+/* only written to the output profile */
+static inline IBool _vfi_keep_histograms(const vprec_context_t *ctx) {
+  return ctx->vfi->vprec_output_file != NULL;
 }
 
-/* initialize the context */
-void _vfi_init_context(void *context) {
-  vprec_context_t *ctx = (vprec_context_t *)context;
-  ctx->vfi->map = NULL;
-  ctx->vfi->vprec_input_file = NULL;
-  ctx->vfi->vprec_output_file = NULL;
-  ctx->vfi->vprec_log_file = NULL;
-  ctx->vfi->vprec_inst_mode = VPREC_INST_MODE_DEFAULT;
-  ctx->vfi->vprec_log_depth = 0;
+/* return the zeroed exponent histograms of nb_args arguments, stored one */
+/* after the other, or NULL if they are not kept */
+static ISize_t *_vfi_alloc_histograms(vprec_context_t *ctx, int nb_args) {
+  if (!_vfi_keep_histograms(ctx) || nb_args <= 0)
+    return NULL;
+  size_t size = nb_args * VFI_HIST_BINS * sizeof(ISize_t);
+  ISize_t *histograms = _vfi_arena_alloc(&ctx->vfi->arena, size);
+  memset(histograms, 0, size);
+  return histograms;
 }
 
-/* initialize the variables to run vprec function instrumentation */
-void _vfi_init(void *context) {
-  INIT_STRING(tokens_header, elt_to_read_header);
-  INIT_STRING(tokens_inputs, elt_to_read_inputs);
-  INIT_STRING(tokens_outputs, elt_to_read_outputs);
+/* Profile writer */
 
-  vprec_context_t *ctx = (vprec_context_t *)context;
-  /* Initialize the vprec_function_map */
+#define VFI_WRITE_BUFFER_SIZE (1 << 20)
 
-  ctx->vfi->map = vfc_hashmap_create();
-  /* read the hashmap */
-  if (ctx->vfi->vprec_input_file != NULL) {
-    int error = 0;
-    File *f = interflop_fopen(ctx->vfi->vprec_input_file, "r", &error);
-    if (f != NULL) {
-      _vfi_read_hasmap(f, ctx);
-      interflop_fclose(f);
-    } else {
-      logger_error("Input file can't be found: %s", interflop_strerror(error));
-    }
-  }
+// Buffered writer of a profile file
+typedef struct {
+  int fd;
+  char *buffer;
+  size_t size;
+  // errno of the first failed write, 0 if none failed
+  int error;
+} _vfi_writer_t;
 
-  if (ctx->vfi->vprec_log_file != NULL) {
-    int error = 0;
-    File *f = interflop_fopen(ctx->vfi->vprec_log_file, "w", &error);
-    if (f != NULL) {
-      _vprec_log_file = f;
-    } else {
-      logger_error("Error while opening %s: %s", ctx->vfi->vprec_log_file,
-                   interflop_strerror(error));
-    }
-  }
+/* write size bytes to the file of writer, unless a write already failed */
+static void _vfi_writer_write(_vfi_writer_t *writer, const char *bytes,
+                              size_t size) {
+  if (writer->error == 0)
+    _vprec_os_write(writer->fd, bytes, size, &writer->error);
 }
 
-/* free objects and close files */
-void _vfi_finalize(void *context) {
-  vprec_context_t *ctx = (vprec_context_t *)context;
+static void _vfi_writer_flush(_vfi_writer_t *writer) {
+  _vfi_writer_write(writer, writer->buffer, writer->size);
+  writer->size = 0;
+}
 
-  /* save the hashmap */
-  if (ctx->vfi->vprec_output_file != NULL) {
-    int error = 0;
-    File *f = interflop_fopen(ctx->vfi->vprec_output_file, "w", &error);
-    if (f != NULL) {
-      _vfi_write_hasmap(f, ctx);
-      interflop_fclose(f);
-    } else {
-      logger_error("Output file can't be written: %s",
-                   interflop_strerror(error));
-    }
+/* format into the buffer, flushed when full */
+static void _vfi_writer_printf(_vfi_writer_t *writer, const char *format,
+                               ...) {
+  va_list ap;
+  va_start(ap, format);
+  size_t space = VFI_WRITE_BUFFER_SIZE - writer->size;
+  int len = vsnprintf(writer->buffer + writer->size, space, format, ap);
+  va_end(ap);
+  if (len < 0) {
+    logger_error("Output profile can't be formatted: %s",
+                 interflop_strerror(errno));
+  }
+  if ((size_t)len < space) {
+    writer->size += len;
+    return;
   }
 
-  /* close log file */
-  if (_vprec_log_file != NULL) {
-    interflop_fclose(_vprec_log_file);
+  _vfi_writer_flush(writer);
+  va_start(ap, format);
+  if (len < VFI_WRITE_BUFFER_SIZE) {
+    writer->size = vsnprintf(writer->buffer, VFI_WRITE_BUFFER_SIZE, format, ap);
+  } else {
+    /* longer than the buffer, only with huge ids */
+    char *line = interflop_malloc(len + 1);
+    vsnprintf(line, len + 1, format, ap);
+    _vfi_writer_write(writer, line, len);
+    interflop_free(line);
   }
+  va_end(ap);
+}
 
-  /* free vprec_function_map */
-  vfc_hashmap_free(ctx->vfi->map);
+// Write the exponent histogram of an argument as a tab-separated field of
+// comma-separated bin:count pairs, z being the bin of zeros and the other
+// bins the signed bit length of the exponent, or - if the histogram is empty
+// or NULL
+static void _vfi_write_histogram(_vfi_writer_t *fout,
+                                 const ISize_t *histogram) {
+  const char *separator = "\t";
+  for (int i = 0; histogram != NULL && i < VFI_HIST_BINS; i++) {
+    if (histogram[i] == 0)
+      continue;
+    if (i == VFI_HIST_ZERO)
+      _vfi_writer_printf(fout, "%sz:%zu", separator, histogram[i]);
+    else
+      _vfi_writer_printf(fout, "%s%d:%zu", separator,
+                         i - (VFI_HIST_EXP_BITS + 1), histogram[i]);
+    separator = ",";
+  }
+  _vfi_writer_printf(fout, "%s\n", (separator[0] == '\t') ? "\t-" : "");
+}
 
-  /* destroy vprec_function_map */
-  vfc_hashmap_destroy(ctx->vfi->map);
+// Write one function in the given file
+static void _vfi_write_function(_vfi_writer_t *fout, _vfi_t *function) {
+  _vfi_writer_printf(
+      fout, "%s\t%hd\t%hd\t%zu\t%zu\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
+      function->id, function->isLibraryFunction, function->isIntrinsicFunction,
+      function->useFloat, function->useDouble, function->OpsPrec64,
+      function->OpsRange64, function->OpsPrec32, function->OpsRange32,
+      function->nb_input_args, function->nb_output_args, function->n_calls);
+  for (int i = 0; i < function->nb_input_args; i++) {
+    _vfi_writer_printf(fout, "input:\t%s\t%hd\t%d\t%d\t%d\t%d",
+                       function->input_args[i].arg_id,
+                       function->input_args[i].data_type,
+                       function->input_args[i].mantissa_length,
+                       function->input_args[i].exponent_length,
+                       function->input_args[i].min_range,
+                       function->input_args[i].max_range);
+    _vfi_write_histogram(fout, function->input_args[i].exponent_hist);
+  }
+  for (int i = 0; i < function->nb_output_args; i++) {
+    _vfi_writer_printf(fout, "output:\t%s\t%hd\t%d\t%d\t%d\t%d",
+                       function->output_args[i].arg_id,
+                       function->output_args[i].data_type,
+                       function->output_args[i].mantissa_length,
+                       function->output_args[i].exponent_length,
+                       function->output_args[i].min_range,
+                       function->output_args[i].max_range);
+    _vfi_write_histogram(fout, function->output_args[i].exponent_hist);
+  }
+}
 
-  FREE_STRING(tokens_header, elt_to_read_header);
-  FREE_STRING(tokens_inputs, elt_to_read_inputs);
-  FREE_STRING(tokens_outputs, elt_to_read_outputs);
+// Write the record at slot of the input profile in the given file, as the
+// function created from it would be written
+static void _vfi_write_record(_vfi_writer_t *fout,
+                              const _vfi_profile_t *profile, uint32_t slot) {
+  const _vfi_profile_function_t *record = &profile->functions[slot];
+  _vfi_writer_printf(
+      fout, "%s\t%hd\t%hd\t%zu\t%zu\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
+      profile->strings + record->id, record->isLibraryFunction,
+      record->isIntrinsicFunction, (size_t)record->useFloat,
+      (size_t)record->useDouble, record->OpsPrec64, record->OpsRange64,
+      record->OpsPrec32, record->OpsRange32, record->nb_input_args,
+      record->nb_output_args, record->n_calls);
+  int nb_args = record->nb_input_args + record->nb_output_args;
+  for (int i = 0; i < nb_args; i++) {
+    const _vfi_profile_argument_t *arg =
+        &profile->arguments[record->first_arg + i];
+    _vfi_writer_printf(fout, "%s:\t%s\t%hd\t%d\t%d\t%d\t%d",
+                       (i < record->nb_input_args) ? "input" : "output",
+                       profile->strings + arg->arg_id, (short)arg->data_type,
+                       arg->mantissa_length, arg->exponent_length,
+                       arg->min_range, arg->max_range);
+    const uint64_t *stored =
+        &profile->histograms[(record->first_arg + i) * VFI_PROFILE_HIST_BINS];
+    ISize_t histogram[VFI_HIST_BINS];
+    for (int j = 0; j < VFI_HIST_BINS; j++)
+      histogram[j] = stored[j];
+    _vfi_write_histogram(fout, histogram);
+  }
 }
 
-// vprec function instrumentation
-// Set precision for internal operations and round input arguments for a given
-// function call
-void _vfi_enter_function(interflop_function_stack_t *stack, void *context,
-                         int nb_args, va_list ap) {
-  vprec_context_t *ctx = (vprec_context_t *)context;
+// Function of an output profile: a function created during the run, or the
+// record at slot of the input profile if the function was never called
+typedef struct {
+  const char *id;
+  _vfi_t *function;
+  uint32_t slot;
+} _vfi_entry_t;
 
-  interflop_function_info_t *function_info = stack->array[stack->top];
+static int _vfi_compare_ids(const void *a, const void *b) {
+  return strcmp(((const _vfi_entry_t *)a)->id, ((const _vfi_entry_t *)b)->id);
+}
 
-  if (function_info == NULL)
-    logger_error("Call stack error\n");
+/* return the functions of the hashmap and of the input profile, their */
+/* number being stored in nb_functions. The functions of the input profile */
+/* are not created, the lock of the context must be held */
+static _vfi_entry_t *_vfi_collect_functions(vprec_context_t *ctx,
+                                            size_t *nb_functions) {
+  size_t n = 0;
+  _vfi_entry_t *entries = interflop_malloc(
+      (vfc_hashmap_num_items(ctx->vfi->map) + ctx->vfi->index.nb_keys + 1) *
+      sizeof(_vfi_entry_t));
 
-  _vfi_t *function_inst = vfc_hashmap_get(
-      ctx->vfi->map, vfc_hashmap_str_function(function_info->id));
-
-  // if the function is not in the hashtable
-  if (function_inst == NULL) {
-    function_inst = interflop_malloc(sizeof(_vfi_t));
-
-    // initialize the structure
-    interflop_strcpy(function_inst->id, function_info->id);
-    function_inst->isLibraryFunction = function_info->isLibraryFunction;
-    function_inst->isIntrinsicFunction = function_info->isIntrinsicFunction;
-    function_inst->useFloat = function_info->useFloat;
-    function_inst->useDouble = function_info->useDouble;
-    function_inst->OpsRange64 = VPREC_RANGE_BINARY64_DEFAULT;
-    function_inst->OpsPrec64 = VPREC_PRECISION_BINARY64_DEFAULT;
-    function_inst->OpsRange32 = VPREC_RANGE_BINARY32_DEFAULT;
-    function_inst->OpsPrec32 = VPREC_PRECISION_BINARY32_DEFAULT;
-    function_inst->nb_input_args = 0;
-    function_inst->input_args = NULL;
-    function_inst->nb_output_args = 0;
-    function_inst->output_args = NULL;
-    function_inst->n_calls = 0;
-
-    // insert the function in the hashmap
-    vfc_hashmap_insert(ctx->vfi->map,
-                       vfc_hashmap_str_function(function_info->id),
-                       function_inst);
+  for (size_t ii = 0; ii < ctx->vfi->map->capacity; ii++) {
+    _vfi_t *function = (_vfi_t *)get_value_at(ctx->vfi->map->items, ii);
+    if (function != NULL) {
+      entries[n++] = (_vfi_entry_t){function->id, function, 0};
+    }
   }
 
-  // increment the number of calls
-  function_inst->n_calls++;
-
-  // set internal operations precision with custom values depending on the mode
-  if (!function_info->isLibraryFunction &&
-      !function_info->isIntrinsicFunction &&
-      ctx->vfi->vprec_inst_mode != vprecinst_arg &&
-      ctx->vfi->vprec_inst_mode != vprecinst_none) {
-    _set_vprec_precision_binary64(function_inst->OpsPrec64, ctx);
-    _set_vprec_range_binary64(function_inst->OpsRange64, ctx);
-    _set_vprec_precision_binary32(function_inst->OpsPrec32, ctx);
-    _set_vprec_range_binary32(function_inst->OpsRange32, ctx);
+  // functions of the input profile are not stored in the hashmap, the ones
+  // never called are written from the compiled profile without creating them
+  const _vfi_profile_t *profile = ctx->vfi->profile;
+  for (uint32_t i = 0; i < ctx->vfi->index.nb_keys; i++) {
+    _vfi_t *function = ctx->vfi->profile_slots[i];
+    if (function != NULL)
+      entries[n++] = (_vfi_entry_t){function->id, function, i};
+    else
+      entries[n++] =
+          (_vfi_entry_t){profile->strings + profile->functions[i].id, NULL, i};
   }
 
-  // treatment of arguments
-  int new_flag = (function_inst->input_args == NULL && nb_args > 0);
+  *nb_functions = n;
+  return entries;
+}
 
-  // print function info in log
-  _vfi_print_log(ctx, "\n");
-  _vfi_print_log(ctx, "enter in %s\t%d\t%d\t%d\t%d\n", function_inst->id,
-                 function_inst->OpsPrec64, function_inst->OpsRange64,
-                 function_inst->OpsPrec32, function_inst->OpsRange32);
+// Write the functions in the given file, sorted by id, the records being
+// read from profile
+static void _vfi_write_hasmap(_vfi_writer_t *fout,
+                              const _vfi_profile_t *profile,
+                              _vfi_entry_t *entries, size_t nb_functions) {
+  qsort(entries, nb_functions, sizeof(_vfi_entry_t), _vfi_compare_ids);
+  for (size_t i = 0; i < nb_functions; i++) {
+    if (entries[i].function != NULL)
+      _vfi_write_function(fout, entries[i].function);
+    else
+      _vfi_write_record(fout, profile, entries[i].slot);
+  }
+}
 
-  // allocate memory for arguments
-  if (new_flag) {
-    function_inst->input_args =
-        interflop_malloc(sizeof(_vfi_argument_data_t) * nb_args);
-    function_inst->nb_input_args = nb_args;
+/* environment variables set to the MPI rank by the launchers */
+static const char *const _vfi_rank_variables[] = {
+    "OMPI_COMM_WORLD_RANK", "PMIX_RANK", "PMI_RANK", "MV2_COMM_WORLD_RANK",
+    "SLURM_PROCID", NULL};
+
+/* return the allocated copy of template where %r is replaced by the MPI */
+/* rank, 0 if unknown, %p by the pid and %% by % */
+static char *_vfi_expand_filename(const char *template) {
+  const char *rank = "0";
+  for (int i = 0; _vfi_rank_variables[i] != NULL; i++) {
+    const char *value = interflop_getenv(_vfi_rank_variables[i]);
+    if (value != NULL && value[0] != '\0') {
+      rank = value;
+      break;
+    }
+  }
+  char pid[24];
+  interflop_sprintf(pid, "%ld", (long)_vprec_os_getpid());
+
+  /* the expansion is at most as long as the template with each % replaced */
+  size_t len = strlen(template) + 1;
+  for (const char *c = template; *c; c++)
+    if (*c == '%')
+      len += strlen(rank) + strlen(pid);
+
+  char *filename = interflop_malloc(len);
+  char *end = filename;
+  for (const char *c = template; *c; c++) {
+    const char *value = NULL;
+    if (c[0] == '%' && c[1] == 'r')
+      value = rank;
+    else if (c[0] == '%' && c[1] == 'p')
+      value = pid;
+    else if (c[0] == '%' && c[1] == '%')
+      value = "%";
+    if (value != NULL) {
+      size_t value_len = strlen(value);
+      memcpy(end, value, value_len);
+      end += value_len;
+      c++;
+    } else {
+      *end++ = *c;
+    }
   }
+  *end = '\0';
+  return filename;
+}
 
-  // boolean which indicates if arguments should be rounded or not depending on
-  // modes
-  int mode_flag =
-      (((ctx->mode == vprecmode_full) || (ctx->mode == vprecmode_ib)) &&
-       ((ctx->vfi->vprec_inst_mode == vprecinst_all) ||
-        (ctx->vfi->vprec_inst_mode == vprecinst_arg)) &&
-       ctx->vfi->vprec_inst_mode != vprecinst_none);
+/* write the profile to a temporary file renamed to the expansion of */
+/* template once complete and on disk, so that the profile is never */
+/* truncated, even after a crash of the machine. The records of entries */
+/* are read from profile. Return 0 on success, the errno of the failure */
+/* otherwise */
+static int _vfi_save_profile(const char *template,
+                             const _vfi_profile_t *profile,
+                             _vfi_entry_t *entries, size_t nb_functions) {
+  char *filename = _vfi_expand_filename(template);
+  size_t len = strlen(filename) + 32;
+  char *tmp = interflop_malloc(len);
+  interflop_sprintf(tmp, "%s.tmp.%ld", filename, (long)_vprec_os_getpid());
+
+  _vfi_writer_t writer = {.fd = -1};
+  writer.fd = _vprec_os_create_file(tmp, &writer.error);
+  if (writer.fd == -1) {
+    interflop_free(tmp);
+    interflop_free(filename);
+    return writer.error;
+  }
+  writer.buffer = interflop_malloc(VFI_WRITE_BUFFER_SIZE);
+  _vfi_write_hasmap(&writer, profile, entries, nb_functions);
+  _vfi_writer_flush(&writer);
+  interflop_free(writer.buffer);
 
-  for (int i = 0; i < nb_args; i++) {
-    // get argument type, id and size
-    int type = va_arg(ap, int);
-    char *arg_id = va_arg(ap, char *);
-    unsigned int size = va_arg(ap, unsigned int);
+  /* the data must reach the disk before the rename replaces the profile */
+  int error = 0;
+  if (!_vprec_os_close_file(writer.fd, writer.error == 0, &error) &&
+      writer.error == 0)
+    writer.error = error;
+  if (writer.error == 0)
+    _vprec_os_replace_file(tmp, filename, &writer.error);
+  if (writer.error != 0)
+    _vprec_os_remove_file(tmp);
+  interflop_free(tmp);
+  interflop_free(filename);
+  return writer.error;
+}
 
-    if (new_flag) {
-      function_inst->input_args[i].data_type = type;
-      interflop_strcpy(function_inst->input_args[i].arg_id, arg_id);
-      function_inst->input_args[i].min_range = INT_MAX;
-      function_inst->input_args[i].max_range = INT_MIN;
-      function_inst->input_args[i].exponent_length =
-          (type == FDOUBLE || type == FDOUBLE_PTR)
-              ? VPREC_RANGE_BINARY64_DEFAULT
-              : VPREC_RANGE_BINARY32_DEFAULT;
-      function_inst->input_args[i].mantissa_length =
-          (type == FDOUBLE || type == FDOUBLE_PTR)
-              ? VPREC_PRECISION_BINARY64_DEFAULT
-              : VPREC_PRECISION_BINARY32_DEFAULT;
-    }
-
-    if (type == FDOUBLE) {
-      double *value = va_arg(ap, double *);
-
-      _vfi_print_log(ctx, " - %s\tinput\tdouble\t%s\t%la\t->\t",
-                     function_inst->id, arg_id, *value);
-
-      if ((!new_flag) && mode_flag) {
-        *value = _vprec_round_binary64(
-            *value, 1, context, function_inst->input_args[i].exponent_length,
-            function_inst->input_args[i].mantissa_length);
-      }
+/* Checkpoints */
+
+// Copy of the functions taken and written by the checkpoint thread
+typedef struct {
+  // copies of the functions and of their arguments
+  _vfi_arena_t arena;
+  _vfi_entry_t *functions;
+  size_t nb_functions;
+  // input profile of the records, mapped until the checkpoints stop
+  const _vfi_profile_t *profile;
+  const char *filename;
+} _vfi_snapshot_t;
+
+static struct {
+  pthread_t thread;
+  IBool running;
+  // pid of the process running the checkpoint thread
+  pid_t owner;
+  // posted by the timer, SIGUSR1 and the call counts to trigger a checkpoint
+  sem_t trigger;
+  int stop;
+  // SIGUSR1 handler restored when the checkpoints stop
+  struct sigaction previous;
+  IBool signal_installed;
+} _vfi_checkpoint;
+
+/* number of instrumented calls of the process, a checkpoint is triggered */
+/* every --prec-checkpoint-calls of them */
+static uint64_t _vfi_checkpoint_calls = 0;
+
+static void _vfi_checkpoint_signal(int signum) {
+  (void)signum;
+  /* async-signal-safe */
+  sem_post(&_vfi_checkpoint.trigger);
+}
 
-      if (!(interflop_isnan(*value) || interflop_isinf(*value))) {
-        function_inst->input_args[i].min_range =
-            (interflop_floor(*value) < function_inst->input_args[i].min_range ||
-             new_flag)
-                ? interflop_floor(*value)
-                : function_inst->input_args[i].min_range;
-        function_inst->input_args[i].max_range =
-            (interflop_ceil(*value) > function_inst->input_args[i].max_range ||
-             new_flag)
-                ? interflop_ceil(*value)
-                : function_inst->input_args[i].max_range;
-      }
+static void _vfi_snapshot_free(_vfi_snapshot_t *snapshot) {
+  _vfi_arena_free(&snapshot->arena);
+  interflop_free(snapshot->functions);
+  interflop_free(snapshot);
+}
 
-      _vfi_print_log(ctx, "%la\t(%d, %d)\n", *value,
-                     function_inst->input_args[i].mantissa_length,
-                     function_inst->input_args[i].exponent_length);
+/* copy the arguments of a function into the arena of a snapshot */
+static _vfi_argument_data_t *
+_vfi_snapshot_args(_vfi_snapshot_t *snapshot, const _vfi_argument_data_t *args,
+                   int nb_args) {
+  _vfi_argument_data_t *copy = _vfi_arena_alloc(
+      &snapshot->arena, nb_args * sizeof(_vfi_argument_data_t));
+  if (nb_args > 0)
+    memcpy(copy, args, nb_args * sizeof(_vfi_argument_data_t));
+  for (int i = 0; i < nb_args; i++) {
+    if (args[i].exponent_hist == NULL)
+      continue;
+    copy[i].exponent_hist =
+        _vfi_arena_alloc(&snapshot->arena, VFI_HIST_BINS * sizeof(ISize_t));
+    memcpy(copy[i].exponent_hist, args[i].exponent_hist,
+           VFI_HIST_BINS * sizeof(ISize_t));
+  }
+  return copy;
+}
 
-    } else if (type == FFLOAT) {
-      float *value = va_arg(ap, float *);
+/* copy the statistics of the functions created so far, ids are interned */
+/* and kept as is. The lock of the context keeps the instrumented threads */
+/* from creating functions and binding arguments meanwhile, the counters */
+/* of the calls in progress may be copied before or after their update */
+static _vfi_snapshot_t *_vfi_snapshot(vprec_context_t *ctx) {
+  _vfi_snapshot_t *snapshot = interflop_malloc(sizeof(_vfi_snapshot_t));
+  _vfi_arena_init(&snapshot->arena);
+  snapshot->filename = ctx->vfi->vprec_output_file;
+  snapshot->profile = ctx->vfi->profile;
+  pthread_mutex_lock(&ctx->vfi->lock);
+  snapshot->functions = _vfi_collect_functions(ctx, &snapshot->nb_functions);
+  for (size_t i = 0; i < snapshot->nb_functions; i++) {
+    const _vfi_t *function = snapshot->functions[i].function;
+    if (function == NULL)
+      continue;
+    _vfi_t *copy = _vfi_arena_alloc(&snapshot->arena, sizeof(_vfi_t));
+    *copy = *function;
+    copy->input_args =
+        _vfi_snapshot_args(snapshot, copy->input_args, copy->nb_input_args);
+    copy->output_args =
+        _vfi_snapshot_args(snapshot, copy->output_args, copy->nb_output_args);
+    snapshot->functions[i].function = copy;
+  }
+  pthread_mutex_unlock(&ctx->vfi->lock);
+  return snapshot;
+}
 
-      _vfi_print_log(ctx, " - %s\tinput\tfloat\t%s\t%a\t->\t",
-                     function_inst->id, arg_id, *value);
+/* count the call on function entry, every checkpoint_calls calls of the */
+/* process trigger a checkpoint */
+static inline void _vfi_checkpoint_count(vprec_context_t *ctx) {
+  int period = ctx->vfi->checkpoint_calls;
+  if (period == 0)
+    return;
+  uint64_t calls =
+      __atomic_add_fetch(&_vfi_checkpoint_calls, 1, __ATOMIC_RELAXED);
+  if (calls % period == 0 &&
+      __atomic_load_n(&_vfi_checkpoint.running, __ATOMIC_RELAXED))
+    sem_post(&_vfi_checkpoint.trigger);
+}
 
-      if ((!new_flag) && mode_flag) {
-        *value = _vprec_round_binary32(
-            *value, 1, context, function_inst->input_args[i].exponent_length,
-            function_inst->input_args[i].mantissa_length);
-      }
+/* wait for a trigger, take a snapshot and write it */
+static void *_vfi_checkpoint_writer(void *arg) {
+  vprec_context_t *ctx = (vprec_context_t *)arg;
+  int interval = ctx->vfi->checkpoint_interval;
+
+  for (;;) {
+    if (interval > 0) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_sec += interval;
+      while (sem_timedwait(&_vfi_checkpoint.trigger, &deadline) == -1 &&
+             errno == EINTR)
+        ;
+    } else {
+      while (sem_wait(&_vfi_checkpoint.trigger) == -1 && errno == EINTR)
+        ;
+    }
+    /* the triggers received meanwhile are served by this checkpoint */
+    while (sem_trywait(&_vfi_checkpoint.trigger) == 0)
+      ;
+    if (__atomic_load_n(&_vfi_checkpoint.stop, __ATOMIC_ACQUIRE))
+      break;
+
+    /* the instrumented threads only wait for the copy, not for the write */
+    _vfi_snapshot_t *snapshot = _vfi_snapshot(ctx);
+    int error = _vfi_save_profile(snapshot->filename, snapshot->profile,
+                                  snapshot->functions, snapshot->nb_functions);
+    if (error != 0) {
+      logger_warning("Checkpoint of %s can't be written: %s\n",
+                     snapshot->filename, interflop_strerror(error));
+    }
+    _vfi_snapshot_free(snapshot);
+  }
+  return NULL;
+}
 
-      if (!(interflop_isnan(*value) || interflop_isinf(*value))) {
-        function_inst->input_args[i].min_range =
-            (interflop_floor(*value) < function_inst->input_args[i].min_range ||
-             new_flag)
-                ? interflop_floor(*value)
-                : function_inst->input_args[i].min_range;
-        function_inst->input_args[i].max_range =
-            (interflop_ceil(*value) > function_inst->input_args[i].max_range ||
-             new_flag)
-                ? interflop_ceil(*value)
-                : function_inst->input_args[i].max_range;
-      }
+/* start the checkpoint thread and install the SIGUSR1 handler */
+static void _vfi_checkpoint_start(vprec_context_t *ctx) {
+  t_context_vfi *vfi = ctx->vfi;
+  if (vfi->checkpoint_interval == 0 && vfi->checkpoint_calls == 0 &&
+      !vfi->checkpoint_signal)
+    return;
+  if (vfi->vprec_output_file == NULL) {
+    logger_warning("--%s, --%s and --%s need --%s, no checkpoint is "
+                   "written\n",
+                   key_checkpoint_interval_str, key_checkpoint_calls_str,
+                   key_checkpoint_signal_str, key_output_file_str);
+    return;
+  }
 
-      _vfi_print_log(ctx, "%a\t(%d, %d)\n", *value,
-                     function_inst->input_args[i].mantissa_length,
-                     function_inst->input_args[i].exponent_length);
-
-    } else if (type == FDOUBLE_PTR) {
-      double *value = va_arg(ap, double *);
-
-      for (unsigned int j = 0; j < size; j++, value++) {
-        if (value == NULL) {
-          _vfi_print_log(ctx,
-                         " - %s\tinput[%u]\tdouble_ptr\t%s\tNULL\t->\tNULL\n",
-                         function_inst->id, j, arg_id);
-          continue;
-        }
-
-        _vfi_print_log(ctx, " - %s\tinput[%u]\tdouble_ptr\t%s\t%la\t->\t",
-                       function_inst->id, j, arg_id, *value);
-
-        if ((!new_flag) && mode_flag) {
-          *value = _vprec_round_binary64(
-              *value, 1, context, function_inst->input_args[i].exponent_length,
-              function_inst->input_args[i].mantissa_length);
-        }
-
-        if (!(interflop_isnan(*value) || interflop_isinf(*value))) {
-          function_inst->input_args[i].min_range =
-              (interflop_floor(*value) <
-                   function_inst->input_args[i].min_range ||
-               new_flag)
-                  ? interflop_floor(*value)
-                  : function_inst->input_args[i].min_range;
-          function_inst->input_args[i].max_range =
-              (interflop_ceil(*value) >
-                   function_inst->input_args[i].max_range ||
-               new_flag)
-                  ? interflop_ceil(*value)
-                  : function_inst->input_args[i].max_range;
-        }
-
-        _vfi_print_log(ctx, "%la\t(%d, %d)\n", *value,
-                       function_inst->input_args[i].mantissa_length,
-                       function_inst->input_args[i].exponent_length);
-      }
-    } else if (type == FFLOAT_PTR) {
-      float *value = va_arg(ap, float *);
-
-      for (unsigned int j = 0; j < size; j++, value++) {
-        if (value == NULL) {
-          _vfi_print_log(ctx,
-                         " - %s\tinput[%u]\tfloat_ptr\t%s\tNULL\t->\tNULL\n",
-                         function_inst->id, j, arg_id);
-          continue;
-        }
-
-        _vfi_print_log(ctx, " - %s\tinput[%u]\tfloat_ptr\t%s\t%a\t->\t",
-                       function_inst->id, j, arg_id, *value);
-
-        if ((!new_flag) && mode_flag) {
-          *value = _vprec_round_binary32(
-              *value, 1, context, function_inst->input_args[i].exponent_length,
-              function_inst->input_args[i].mantissa_length);
-        }
-
-        if (!(interflop_isnan(*value) || interflop_isinf(*value))) {
-          function_inst->input_args[i].min_range =
-              (interflop_floor(*value) <
-                   function_inst->input_args[i].min_range ||
-               new_flag)
-                  ? interflop_floor(*value)
-                  : function_inst->input_args[i].min_range;
-          function_inst->input_args[i].max_range =
-              (interflop_ceil(*value) >
-                   function_inst->input_args[i].max_range ||
-               new_flag)
-                  ? interflop_ceil(*value)
-                  : function_inst->input_args[i].max_range;
-        }
-
-        _vfi_print_log(ctx, "%a\t(%d, %d)\n", *value,
-                       function_inst->input_args[i].mantissa_length,
-                       function_inst->input_args[i].exponent_length);
-      }
-    }
+  sem_init(&_vfi_checkpoint.trigger, 0, 0);
+  _vfi_checkpoint.stop = 0;
+  _vfi_checkpoint.owner = _vprec_os_getpid();
+  IBool running = pthread_create(&_vfi_checkpoint.thread, NULL,
+                                 _vfi_checkpoint_writer, ctx) == 0;
+  __atomic_store_n(&_vfi_checkpoint.running, running, __ATOMIC_RELEASE);
+  if (!running) {
+    logger_warning("Can't create the checkpoint thread, the output profile "
+                   "is only written at exit\n");
+    sem_destroy(&_vfi_checkpoint.trigger);
+    return;
   }
 
-  // increment depth
-  ctx->vfi->vprec_log_depth++;
+  if (vfi->checkpoint_signal) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = _vfi_checkpoint_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    _vfi_checkpoint.signal_installed =
+        sigaction(SIGUSR1, &action, &_vfi_checkpoint.previous) == 0;
+  }
 }
 
-// vprec function instrumentation
-// Set precision for internal operations and round output arguments for a given
-// function call
-void _vfi_exit_function(interflop_function_stack_t *stack, void *context,
-                        int nb_args, va_list ap) {
+/* stop the checkpoint thread once its current checkpoint is written */
+static void _vfi_checkpoint_stop(void) {
+  if (!_vfi_checkpoint.running)
+    return;
+
+  if (_vfi_checkpoint.signal_installed) {
+    sigaction(SIGUSR1, &_vfi_checkpoint.previous, NULL);
+    _vfi_checkpoint.signal_installed = false;
+  }
+  __atomic_store_n(&_vfi_checkpoint.running, false, __ATOMIC_RELAXED);
+  /* the checkpoint thread does not exist in a forked child */
+  if (_vfi_checkpoint.owner == _vprec_os_getpid()) {
+    __atomic_store_n(&_vfi_checkpoint.stop, 1, __ATOMIC_RELEASE);
+    sem_post(&_vfi_checkpoint.trigger);
+    pthread_join(_vfi_checkpoint.thread, NULL);
+  }
+  sem_destroy(&_vfi_checkpoint.trigger);
+}
+
+/* Helper function scanning an integer */
+/* return the integer upon success */
+/* otherwise call logger_error  */
+long _vfi_scan_int(char *token, const char *field) {
+  int error = 0;
+  char *endptr;
+  long res = interflop_strtol(token, &endptr, &error);
+  if (error != 0) {
+    logger_error("Error while reading hashmap config file (field: %s)\n",
+                 field);
+  }
+  return res;
+}
+
+/* Helper function scanning an exponent histogram written by */
+/* _vfi_write_histogram and adding it to the histogram of arg */
+static void _vfi_scan_histogram(char *token, _vfi_argument_data_t *arg) {
+  token[strcspn(token, "\n")] = '\0';
+  if (interflop_strcmp(token, "-") == 0)
+    return;
+
+  char *commaptr;
+  char *bin = interflop_strtok_r(token, ",", &commaptr);
+  while (bin) {
+    char *count = strchr(bin, ':');
+    if (count == NULL) {
+      logger_error("Error while reading hashmap config file (field: %s)\n",
+                   "exponent_hist");
+    }
+    *count++ = '\0';
+    long index = VFI_HIST_ZERO;
+    if (interflop_strcmp(bin, "z") != 0) {
+      long bits = _vfi_scan_int(bin, "exponent_hist");
+      if (bits < -VFI_HIST_EXP_BITS || VFI_HIST_EXP_BITS < bits) {
+        logger_error("invalid exponent_hist bin for %s (%ld). Must be z or "
+                     "in [%d, %d]",
+                     arg->arg_id, bits, -VFI_HIST_EXP_BITS, VFI_HIST_EXP_BITS);
+      }
+      index = VFI_HIST_EXP_BITS + 1 + bits;
+    }
+    arg->exponent_hist[index] += _vfi_scan_int(count, "exponent_hist");
+    bin = interflop_strtok_r(NULL, ",", &commaptr);
+  }
+}
+
+/* split a line of the profile on tabs, storing at most max_tokens tokens */
+/* pointing into the line and returning the number of tokens of the line */
+static int _vfi_split_line(char *line, char **tokens, int max_tokens) {
+  char *tabptr;
+  char *token = interflop_strtok_r(line, "\t", &tabptr);
+  int nb_token = 0;
+  while (token && nb_token < max_tokens) {
+    tokens[nb_token] = token;
+    nb_token++;
+    token = interflop_strtok_r(NULL, "\t", &tabptr);
+  }
+  return token ? max_tokens + 1 : nb_token;
+}
+
+static void _vfi_parse_header(char **tokens, _vfi_t *function_ptr,
+                              _vfi_string_pool_t *pool) {
+  function_ptr->id = _vfi_intern(pool, tokens[0]);
+  function_ptr->isLibraryFunction =
+      _vfi_scan_int(tokens[1], "isLibraryFunction");
+  function_ptr->isIntrinsicFunction =
+      _vfi_scan_int(tokens[2], "isIntrinsicFunction");
+  function_ptr->useFloat = _vfi_scan_int(tokens[3], "useFloat");
+  function_ptr->useDouble = _vfi_scan_int(tokens[4], "useDouble");
+  function_ptr->OpsPrec64 = _vfi_scan_int(tokens[5], "OpsPrec64");
+  function_ptr->OpsRange64 = _vfi_scan_int(tokens[6], "OpsRange64");
+  function_ptr->OpsPrec32 = _vfi_scan_int(tokens[7], "OpsPrec32");
+  function_ptr->OpsRange32 = _vfi_scan_int(tokens[8], "OpsRange32");
+  function_ptr->nb_input_args = _vfi_scan_int(tokens[9], "nb_input_args");
+  function_ptr->nb_output_args = _vfi_scan_int(tokens[10], "nb_output_args");
+  function_ptr->n_calls = _vfi_scan_int(tokens[11], "n_calls");
+}
+
+static _vfi_argument_handler_t _vfi_argument_handler(int type);
+
+/* parse an input or output argument line split in nb_token tokens, its */
+/* exponent histogram is read into histogram unless it is NULL */
+static void _vfi_parse_argument(char **tokens, int nb_token,
+                                _vfi_argument_data_t *arg_data,
+                                ISize_t *histogram, _vfi_string_pool_t *pool) {
+  // tokens[0] == "input:" or "output:"
+  arg_data->arg_id = _vfi_intern(pool, tokens[1]);
+  arg_data->data_type = _vfi_scan_int(tokens[2], "data_type");
+  arg_data->handler = _vfi_argument_handler(arg_data->data_type);
+  arg_data->mantissa_length = _vfi_scan_int(tokens[3], "mantissa_length");
+  arg_data->exponent_length = _vfi_scan_int(tokens[4], "exponent_length");
+  arg_data->min_range = _vfi_scan_int(tokens[5], "min_range");
+  arg_data->max_range = _vfi_scan_int(tokens[6], "max_range");
+  arg_data->exponent_hist = histogram;
+  // profiles written without exponent histograms have one field less
+  if (histogram != NULL && nb_token == elt_to_read_inputs)
+    _vfi_scan_histogram(tokens[7], arg_data);
+}
+
+/* index the functions read from a text profile with a minimal perfect */
+/* hash, falling back to the hashmap if no perfect hash is found */
+static void _vfi_index_functions(vprec_context_t *ctx, _vfi_t **functions,
+                                 uint32_t nb_functions) {
+  if (nb_functions == 0)
+    return;
+
+  const char **ids = interflop_malloc(nb_functions * sizeof(char *));
+  uint32_t *order = interflop_malloc(nb_functions * sizeof(uint32_t));
+  for (uint32_t i = 0; i < nb_functions; i++)
+    ids[i] = functions[i]->id;
+
+  /* a duplicated id would leave one of its entries unreachable */
+  uint32_t duplicate = _vfi_find_duplicate(ids, nb_functions);
+  if (duplicate != nb_functions) {
+    logger_error("Function %s appears more than once in %s\n", ids[duplicate],
+                 ctx->vfi->vprec_input_file);
+  }
+
+  if (_vfi_mph_build(&ctx->vfi->index, ids, nb_functions, order) == 0) {
+    ctx->vfi->profile_slots = interflop_malloc(nb_functions * sizeof(_vfi_t *));
+    for (uint32_t slot = 0; slot < nb_functions; slot++)
+      ctx->vfi->profile_slots[slot] = functions[order[slot]];
+  } else {
+    logger_warning("No perfect hash found for %s, using the hashmap\n",
+                   ctx->vfi->vprec_input_file);
+    for (uint32_t i = 0; i < nb_functions; i++)
+      vfc_hashmap_insert(ctx->vfi->map,
+                         vfc_hashmap_str_function(functions[i]->id),
+                         functions[i]);
+  }
+
+  interflop_free(ids);
+  interflop_free(order);
+}
+
+/* check that the internal operations precision and range of a function of */
+/* the input profile can be set without validation on function entry */
+static void _vfi_check_function(const _vfi_t *function) {
+  if (function->OpsPrec64 < VPREC_PRECISION_BINARY64_MIN ||
+      VPREC_PRECISION_BINARY64_MAX < function->OpsPrec64) {
+    logger_error("invalid OpsPrec64 for %s (%d). Must be in [%d, %d]",
+                 function->id, function->OpsPrec64,
+                 VPREC_PRECISION_BINARY64_MIN, VPREC_PRECISION_BINARY64_MAX);
+  }
+  if (function->OpsRange64 < VPREC_RANGE_BINARY64_MIN ||
+      VPREC_RANGE_BINARY64_MAX < function->OpsRange64) {
+    logger_error("invalid OpsRange64 for %s (%d). Must be in [%d, %d]",
+                 function->id, function->OpsRange64, VPREC_RANGE_BINARY64_MIN,
+                 VPREC_RANGE_BINARY64_MAX);
+  }
+  if (function->OpsPrec32 < VPREC_PRECISION_BINARY32_MIN ||
+      VPREC_PRECISION_BINARY32_MAX < function->OpsPrec32) {
+    logger_error("invalid OpsPrec32 for %s (%d). Must be in [%d, %d]",
+                 function->id, function->OpsPrec32,
+                 VPREC_PRECISION_BINARY32_MIN, VPREC_PRECISION_BINARY32_MAX);
+  }
+  if (function->OpsRange32 < VPREC_RANGE_BINARY32_MIN ||
+      VPREC_RANGE_BINARY32_MAX < function->OpsRange32) {
+    logger_error("invalid OpsRange32 for %s (%d). Must be in [%d, %d]",
+                 function->id, function->OpsRange32, VPREC_RANGE_BINARY32_MIN,
+                 VPREC_RANGE_BINARY32_MAX);
+  }
+}
+
+/* true if rounding one of the arguments is not the identity */
+static int _vfi_reduced_arguments(const _vfi_argument_data_t *args,
+                                  int nb_args) {
+  for (int i = 0; i < nb_args; i++) {
+    IBool binary64 =
+        args[i].data_type == FDOUBLE || args[i].data_type == FDOUBLE_PTR;
+    int precision = binary64 ? VPREC_PRECISION_BINARY64_DEFAULT
+                             : VPREC_PRECISION_BINARY32_DEFAULT;
+    int range =
+        binary64 ? VPREC_RANGE_BINARY64_DEFAULT : VPREC_RANGE_BINARY32_DEFAULT;
+    if (args[i].mantissa_length < precision || args[i].exponent_length < range)
+      return 1;
+  }
+  return 0;
+}
+
+/* compute the flags of a function of the input profile */
+static void _vfi_update_flags(_vfi_t *function) {
+  function->flags = 0;
+  if (_vfi_reduced_arguments(function->input_args, function->nb_input_args))
+    function->flags |= VFI_REDUCED_INPUTS;
+  if (_vfi_reduced_arguments(function->output_args, function->nb_output_args))
+    function->flags |= VFI_REDUCED_OUTPUTS;
+}
+
+/* Parallel parsing of text profiles */
+
+/* text profiles smaller than this are parsed by the calling thread */
+#define VFI_PARSE_CHUNK_MIN (1 << 20)
+/* number of chunks per thread, to balance the chunks of different costs */
+#define VFI_PARSE_CHUNKS_PER_THREAD 4
+
+// Functions of a chunk of a text profile, starting at a function header
+typedef struct {
+  const char *begin;
+  const char *end;
+  // functions and arguments, moved to the context arena once parsed
+  _vfi_arena_t arena;
+  // ids and argument names, interned again in the context pool
+  _vfi_string_pool_t strings;
+  _vfi_t **functions;
+  uint32_t nb_functions;
+  uint32_t capacity;
+  // true if the exponent histograms are read, see _vfi_keep_histograms
+  IBool histograms;
+  // true if a malformed header ended the profile in this chunk
+  IBool stopped;
+} _vfi_parse_chunk_t;
+
+/* move all the allocations of from to arena */
+static void _vfi_arena_merge(_vfi_arena_t *arena, _vfi_arena_t *from) {
+  if (from->chunks == NULL)
+    return;
+  _vfi_arena_chunk_t *last = from->chunks;
+  while (last->next != NULL)
+    last = last->next;
+  last->next = arena->chunks;
+  arena->chunks = from->chunks;
+  from->chunks = NULL;
+}
+
+/* copy the line at *cursor to line like fgets and move *cursor to the */
+/* next line, return false at the end of the chunk */
+static IBool _vfi_read_line(const char **cursor, const char *end, char *line) {
+  if (*cursor == end)
+    return false;
+  const char *eol = memchr(*cursor, '\n', end - *cursor);
+  const char *next = (eol != NULL) ? eol + 1 : end;
+  size_t len = next - *cursor;
+  if (len > STRING_BUFF - 1) {
+    logger_error("Line of the input profile longer than %d characters: "
+                 "%.64s...\n",
+                 STRING_BUFF - 1, *cursor);
+  }
+  memcpy(line, *cursor, len);
+  line[len] = '\0';
+  *cursor = next;
+  return true;
+}
+
+/* true if the line at position, before end, starts with prefix */
+static inline IBool _vfi_line_starts_with(const char *position,
+                                          const char *end,
+                                          const char *prefix) {
+  size_t len = strlen(prefix);
+  return (size_t)(end - position) >= len &&
+         memcmp(position, prefix, len) == 0;
+}
+
+/* start of the first function header at or after position in data */
+static const char *_vfi_next_header(const char *data, const char *position,
+                                    const char *end) {
+  if (position > data && position[-1] != '\n') {
+    const char *eol = memchr(position, '\n', end - position);
+    position = (eol != NULL) ? eol + 1 : end;
+  }
+  while (position < end && (_vfi_line_starts_with(position, end, "input:") ||
+                            _vfi_line_starts_with(position, end, "output:"))) {
+    const char *eol = memchr(position, '\n', end - position);
+    position = (eol != NULL) ? eol + 1 : end;
+  }
+  return position;
+}
+
+/* true if the line at position, before end, is a function header */
+static IBool _vfi_is_header(const char *position, const char *end) {
+  char line[STRING_BUFF];
+  char *tokens[elt_to_read_header];
+  return _vfi_read_line(&position, end, line) &&
+         _vfi_split_line(line, tokens, elt_to_read_header) ==
+             elt_to_read_header;
+}
+
+/* parse the arguments of function, is_input selecting the input ones */
+static void _vfi_parse_arguments(_vfi_parse_chunk_t *chunk,
+                                 const char **cursor, _vfi_t *function,
+                                 IBool is_input) {
+  char line[STRING_BUFF];
+  char *tokens[elt_to_read_inputs];
+  int nb_args = is_input ? function->nb_input_args : function->nb_output_args;
+  _vfi_argument_data_t *args =
+      _vfi_arena_alloc(&chunk->arena, nb_args * sizeof(_vfi_argument_data_t));
+
+  ISize_t *histograms = NULL;
+  if (chunk->histograms && nb_args > 0) {
+    histograms = _vfi_arena_alloc(&chunk->arena,
+                                  nb_args * VFI_HIST_BINS * sizeof(ISize_t));
+    memset(histograms, 0, nb_args * VFI_HIST_BINS * sizeof(ISize_t));
+  }
+
+  for (int i = 0; i < nb_args; i++) {
+    int nb_token = 0;
+    if (_vfi_read_line(cursor, chunk->end, line))
+      nb_token = _vfi_split_line(line, tokens, elt_to_read_inputs);
+    if (nb_token != elt_to_read_inputs && nb_token != elt_to_read_inputs - 1) {
+      logger_error("Can't read %s arguments of %s\n",
+                   is_input ? "input" : "output", function->id);
+    }
+    _vfi_parse_argument(tokens, nb_token, &args[i],
+                        histograms ? &histograms[i * VFI_HIST_BINS] : NULL,
+                        &chunk->strings);
+  }
+
+  if (is_input)
+    function->input_args = args;
+  else
+    function->output_args = args;
+}
+
+/* parse the functions of chunk k, task of _vprec_pool_run */
+static void _vfi_parse_chunk(void *arg, int k) {
+  _vfi_parse_chunk_t *chunk = &((_vfi_parse_chunk_t *)arg)[k];
+  char line[STRING_BUFF];
+  char *tokens[elt_to_read_header];
+  const char *cursor = chunk->begin;
+
+  while (_vfi_read_line(&cursor, chunk->end, line)) {
+    if (_vfi_split_line(line, tokens, elt_to_read_header) !=
+        elt_to_read_header) {
+      chunk->stopped = true;
+      break;
+    }
+
+    _vfi_t *function = _vfi_arena_alloc(&chunk->arena, sizeof(_vfi_t));
+    _vfi_parse_header(tokens, function, &chunk->strings);
+    _vfi_parse_arguments(chunk, &cursor, function, true);
+    _vfi_parse_arguments(chunk, &cursor, function, false);
+    _vfi_check_function(function);
+    _vfi_update_flags(function);
+    function->log_generation = 0;
+
+    if (chunk->nb_functions == chunk->capacity) {
+      uint32_t capacity = (chunk->capacity == 0) ? 1024 : 2 * chunk->capacity;
+      _vfi_t **grown = interflop_malloc(capacity * sizeof(_vfi_t *));
+      for (uint32_t i = 0; i < chunk->nb_functions; i++)
+        grown[i] = chunk->functions[i];
+      interflop_free(chunk->functions);
+      chunk->functions = grown;
+      chunk->capacity = capacity;
+    }
+    chunk->functions[chunk->nb_functions++] = function;
+  }
+}
+
+/* parse the size bytes of a text profile, split at function headers into */
+/* chunks parsed by the threads of --instrument-threads */
+static void _vfi_parse_profile(vprec_context_t *ctx, const char *data,
+                               size_t size) {
+  int nb_chunks = 1;
+  if (ctx->vfi->pool != NULL && size >= 2 * VFI_PARSE_CHUNK_MIN) {
+    size_t max_chunks =
+        _vprec_pool_size(ctx->vfi->pool) * VFI_PARSE_CHUNKS_PER_THREAD;
+    nb_chunks = (size / VFI_PARSE_CHUNK_MIN < max_chunks)
+                    ? size / VFI_PARSE_CHUNK_MIN
+                    : max_chunks;
+  }
+
+  _vfi_parse_chunk_t *chunks =
+      interflop_calloc(nb_chunks, sizeof(_vfi_parse_chunk_t));
+  const char *begin = data;
+  int nb_split = 0;
+  for (int k = 0; k < nb_chunks; k++) {
+    const char *end = data + size;
+    if (k < nb_chunks - 1) {
+      const char *target = data + size / nb_chunks * (k + 1);
+      end = _vfi_next_header(data, (target > begin) ? target : begin, end);
+      /* a chunk must start at a well-formed header, otherwise the text up */
+      /* to the next boundary stays in the current chunk */
+      if (!_vfi_is_header(end, data + size))
+        continue;
+    }
+    chunks[nb_split].begin = begin;
+    chunks[nb_split].end = end;
+    _vfi_arena_init(&chunks[nb_split].arena);
+    _vfi_string_pool_init(&chunks[nb_split].strings);
+    chunks[nb_split].histograms = _vfi_keep_histograms(ctx);
+    nb_split++;
+    begin = end;
+  }
+  nb_chunks = nb_split;
+
+  if (nb_chunks > 1)
+    _vprec_pool_run(ctx->vfi->pool, nb_chunks, _vfi_parse_chunk, chunks);
+  else
+    _vfi_parse_chunk(chunks, 0);
+
+  /* the profile ends at the first malformed header, as read serially */
+  int nb_parsed = 0;
+  uint32_t nb_functions = 0;
+  while (nb_parsed < nb_chunks) {
+    nb_functions += chunks[nb_parsed].nb_functions;
+    if (chunks[nb_parsed++].stopped)
+      break;
+  }
+
+  _vfi_t **functions = interflop_malloc(
+      (nb_functions > 0 ? nb_functions : 1) * sizeof(_vfi_t *));
+  uint32_t n = 0;
+  for (int k = 0; k < nb_chunks; k++) {
+    for (uint32_t i = 0; k < nb_parsed && i < chunks[k].nb_functions; i++) {
+      _vfi_t *function = chunks[k].functions[i];
+      function->id = _vfi_intern(&ctx->vfi->strings, function->id);
+      for (int j = 0; j < function->nb_input_args; j++)
+        function->input_args[j].arg_id =
+            _vfi_intern(&ctx->vfi->strings, function->input_args[j].arg_id);
+      for (int j = 0; j < function->nb_output_args; j++)
+        function->output_args[j].arg_id =
+            _vfi_intern(&ctx->vfi->strings, function->output_args[j].arg_id);
+      functions[n++] = function;
+    }
+    if (k < nb_parsed)
+      _vfi_arena_merge(&ctx->vfi->arena, &chunks[k].arena);
+    _vfi_arena_free(&chunks[k].arena);
+    _vfi_string_pool_free(&chunks[k].strings);
+    interflop_free(chunks[k].functions);
+  }
+  interflop_free(chunks);
+
+  // the set of known functions is fixed from now on
+  _vfi_index_functions(ctx, functions, nb_functions);
+  interflop_free(functions);
+}
+
+// Read and initialize the hashmap from the given file
+void _vfi_read_hasmap(FILE *fin, vprec_context_t *ctx) {
+  char line[STRING_BUFF];
+  size_t size = 0;
+  size_t capacity = STRING_BUFF;
+  char *data = interflop_malloc(capacity);
+
+  while (interflop_fgets(line, STRING_BUFF, fin) != NULL) {
+    size_t len = strlen(line);
+    if (size + len > capacity) {
+      char *grown = interflop_malloc(2 * capacity);
+      memcpy(grown, data, size);
+      interflop_free(data);
+      data = grown;
+      capacity *= 2;
+    }
+    memcpy(data + size, line, len);
+    size += len;
+  }
+
+  _vfi_parse_profile(ctx, data, size);
+  interflop_free(data);
+}
+
+/* Log records, formatted by the writer thread (see interflop_vprec_log.c) */
+
+// Log an empty line
+static inline void _vfi_log_blank(vprec_context_t *ctx) {
+  if (_vprec_log_file != NULL) {
+    _vfi_log_record_t record = {.kind = vfilog_blank,
+                                .depth = ctx->vfi->vprec_log_depth};
+    _vfi_log_push(&record);
+  }
+}
+
+// Log the entry (vfilog_enter) or the exit (vfilog_exit) of function
+static inline void _vfi_log_function(vprec_context_t *ctx,
+                                     _vfi_log_kind_t kind,
+                                     const _vfi_t *function) {
+  if (_vprec_log_file != NULL) {
+    _vfi_log_record_t record = {
+        .kind = kind,
+        .depth = ctx->vfi->vprec_log_depth,
+        .lengths = {function->OpsPrec64, function->OpsRange64,
+                    function->OpsPrec32, function->OpsRange32},
+        .function = function->id};
+    _vfi_log_push(&record);
+  }
+}
+
+// Log the element index of an argument of type before and after rounding,
+// the arguments are given as bits, index is ignored for non-pointer types
+static inline void _vfi_log_argument(vprec_context_t *ctx,
+                                     const _vfi_t *function,
+                                     const _vfi_argument_data_t *arg,
+                                     char is_input, int type,
+                                     const char *arg_id, unsigned int index,
+                                     uint64_t before, uint64_t after) {
+  if (_vprec_log_file != NULL) {
+    _vfi_log_record_t record = {
+        .kind = vfilog_argument,
+        .type = type,
+        .is_input = is_input,
+        .depth = ctx->vfi->vprec_log_depth,
+        .index = index,
+        .lengths = {arg->mantissa_length, arg->exponent_length},
+        .function = function->id,
+        .arg_id = arg_id,
+        .before = before,
+        .after = after};
+    _vfi_log_push(&record);
+  }
+}
+
+// Log the element index of a NULL pointer argument
+static inline void _vfi_log_null(vprec_context_t *ctx, const _vfi_t *function,
+                                 char is_input, int type, const char *arg_id,
+                                 unsigned int index) {
+  if (_vprec_log_file != NULL) {
+    _vfi_log_record_t record = {.kind = vfilog_argument,
+                                .type = type,
+                                .is_input = is_input,
+                                .is_null = 1,
+                                .depth = ctx->vfi->vprec_log_depth,
+                                .index = index,
+                                .function = function->id,
+                                .arg_id = arg_id};
+    _vfi_log_push(&record);
+  }
+}
+
+/* allocate the context */
+void _vfi_alloc_context(void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi = (t_context_vfi *)interflop_malloc(sizeof(t_context_vfi));
+}
+
+/* initialize the context */
+void _vfi_init_context(void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  ctx->vfi->map = NULL;
+  ctx->vfi->index.nb_keys = 0;
+  ctx->vfi->index.nb_buckets = 0;
+  ctx->vfi->index.seeds = NULL;
+  ctx->vfi->profile_slots = NULL;
+  ctx->vfi->profile = NULL;
+  ctx->vfi->profile_handle = NULL;
+  ctx->vfi->profile_map = NULL;
+  ctx->vfi->profile_map_size = 0;
+  ctx->vfi->profile_shm_name[0] = '\0';
+  ctx->vfi->profile_shm_header = NULL;
+  ctx->vfi->profile_shm_owner = 0;
+  ctx->vfi->profile_shm_dev = 0;
+  ctx->vfi->profile_shm_ino = 0;
+  ctx->vfi->site_generation = 1;
+  pthread_mutex_init(&ctx->vfi->lock, NULL);
+  ctx->vfi->strings.arena.chunks = NULL;
+  ctx->vfi->strings.strings = NULL;
+  ctx->vfi->strings.capacity = 0;
+  ctx->vfi->strings.nb_strings = 0;
+  _vfi_arena_init(&ctx->vfi->arena);
+  ctx->vfi->vprec_input_file = NULL;
+  ctx->vfi->vprec_output_file = NULL;
+  ctx->vfi->vprec_log_file = NULL;
+  ctx->vfi->vprec_log_format = vfilog_format_text;
+  ctx->vfi->vprec_inst_mode = VPREC_INST_MODE_DEFAULT;
+  ctx->vfi->vprec_log_depth = 0;
+  ctx->vfi->trace_args = false;
+  ctx->vfi->nb_threads = VPREC_INST_THREADS_DEFAULT;
+  ctx->vfi->parallel_threshold = VPREC_INST_THRESHOLD_DEFAULT;
+  ctx->vfi->pool = NULL;
+  ctx->vfi->sample_period = VPREC_INST_SAMPLE_DEFAULT;
+  ctx->vfi->sample_warmup = 0;
+  ctx->vfi->sample_random = false;
+  ctx->vfi->track_ranges = true;
+  ctx->vfi->vprec_log_functions = NULL;
+  ctx->vfi->log_functions_compiled = false;
+  ctx->vfi->log_generation = 0;
+  ctx->vfi->log_max_depth = VPREC_LOG_NO_LIMIT;
+  ctx->vfi->log_max_calls = VPREC_LOG_NO_LIMIT;
+  ctx->vfi->log_max_elements = VPREC_LOG_NO_LIMIT;
+  ctx->vfi->checkpoint_interval = 0;
+  ctx->vfi->checkpoint_calls = 0;
+  ctx->vfi->checkpoint_signal = false;
+  ctx->vfi->input_shared = false;
+}
+
+/* Compiled profiles */
+
+_Static_assert(VFI_HIST_BINS == VFI_PROFILE_HIST_BINS,
+               "profiles store the exponent histograms as they are");
+
+/* copy nb arguments of the compiled profile starting at first */
+static _vfi_argument_data_t *
+_vfi_profile_copy_args(vprec_context_t *ctx, uint32_t first, int nb) {
+  const _vfi_profile_t *profile = ctx->vfi->profile;
+  _vfi_argument_data_t *args =
+      _vfi_arena_alloc(&ctx->vfi->arena, nb * sizeof(_vfi_argument_data_t));
+  for (int i = 0; i < nb; i++) {
+    const _vfi_profile_argument_t *record = &profile->arguments[first + i];
+    // the string table stays mapped as long as the functions are alive
+    args[i].arg_id = profile->strings + record->arg_id;
+    args[i].data_type = record->data_type;
+    args[i].handler = _vfi_argument_handler(record->data_type);
+    args[i].mantissa_length = record->mantissa_length;
+    args[i].exponent_length = record->exponent_length;
+    args[i].min_range = record->min_range;
+    args[i].max_range = record->max_range;
+  }
+  ISize_t *histograms = _vfi_alloc_histograms(ctx, nb);
+  for (int i = 0; i < nb; i++) {
+    args[i].exponent_hist = histograms ? &histograms[i * VFI_HIST_BINS] : NULL;
+    if (histograms == NULL)
+      continue;
+    const uint64_t *histogram =
+        &profile->histograms[(first + i) * VFI_PROFILE_HIST_BINS];
+    for (int j = 0; j < VFI_HIST_BINS; j++)
+      args[i].exponent_hist[j] = histogram[j];
+  }
+  return args;
+}
+
+/* return the function at slot of the input profile, creating it from the */
+/* record of the compiled profile at the first call */
+static _vfi_t *_vfi_profile_materialize(vprec_context_t *ctx, uint32_t slot) {
+  if (ctx->vfi->profile_slots[slot] != NULL)
+    return ctx->vfi->profile_slots[slot];
+
+  const _vfi_profile_t *profile = ctx->vfi->profile;
+  const _vfi_profile_function_t *record = &profile->functions[slot];
+  _vfi_t *function = _vfi_arena_alloc(&ctx->vfi->arena, sizeof(_vfi_t));
+
+  function->id = profile->strings + record->id;
+  function->isLibraryFunction = record->isLibraryFunction;
+  function->isIntrinsicFunction = record->isIntrinsicFunction;
+  function->useFloat = record->useFloat;
+  function->useDouble = record->useDouble;
+  function->OpsPrec64 = record->OpsPrec64;
+  function->OpsRange64 = record->OpsRange64;
+  function->OpsPrec32 = record->OpsPrec32;
+  function->OpsRange32 = record->OpsRange32;
+  function->nb_input_args = record->nb_input_args;
+  function->input_args =
+      _vfi_profile_copy_args(ctx, record->first_arg, record->nb_input_args);
+  function->nb_output_args = record->nb_output_args;
+  function->output_args = _vfi_profile_copy_args(
+      ctx, record->first_arg + record->nb_input_args, record->nb_output_args);
+  function->n_calls = record->n_calls;
+  function->log_generation = 0;
+  _vfi_check_function(function);
+  _vfi_update_flags(function);
+
+  ctx->vfi->profile_slots[slot] = function;
+  return function;
+}
+
+/* true if the input file is a compiled profile */
+static IBool _vfi_is_compiled_profile(const char *filename) {
+  const char suffix[] = ".so";
+  size_t len = strlen(filename);
+  return len >= sizeof(suffix) - 1 &&
+         interflop_strcmp(filename + len - (sizeof(suffix) - 1), suffix) == 0;
+}
+
+/* use the functions of a compiled or binary profile, created at their */
+/* first call */
+static void _vfi_use_profile(vprec_context_t *ctx,
+                             const _vfi_profile_t *profile) {
+  ctx->vfi->profile = profile;
+  ctx->vfi->index.nb_keys = profile->nb_functions;
+  ctx->vfi->index.nb_buckets = profile->nb_buckets;
+  ctx->vfi->index.seeds = profile->seeds;
+  ctx->vfi->profile_slots =
+      interflop_calloc(profile->nb_functions + 1, sizeof(_vfi_t *));
+}
+
+/* dlopen the compiled profile given by --prec-input-file */
+static void _vfi_load_compiled_profile(vprec_context_t *ctx) {
+  const char *filename = ctx->vfi->vprec_input_file;
+
+  /* without a slash, dlopen would search the library path */
+  char *path = interflop_malloc(sizeof(char) * (strlen(filename) + 3));
+  interflop_sprintf(path, "%s%s", strchr(filename, '/') ? "" : "./", filename);
+  void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  interflop_free(path);
+  if (handle == NULL) {
+    logger_error("Compiled profile can't be loaded: %s", dlerror());
+    return;
+  }
+
+  const _vfi_profile_t *profile = dlsym(handle, VFI_PROFILE_SYMBOL);
+  if (profile == NULL) {
+    logger_error("Compiled profile %s does not export %s", filename,
+                 VFI_PROFILE_SYMBOL);
+  } else if (!_vfi_profile_check(profile)) {
+    logger_error("Compiled profile %s was generated for another version of "
+                 "the backend, regenerate it",
+                 filename);
+  }
+
+  ctx->vfi->profile_handle = handle;
+  _vfi_use_profile(ctx, profile);
+}
+
+/* map the input file, using a binary profile in place and parsing a text */
+/* one, return false if the file can't be mapped */
+static IBool _vfi_map_profile(vprec_context_t *ctx) {
+  const char *filename = ctx->vfi->vprec_input_file;
+
+  // the text parser reports the files that can't be read
+  int error = 0;
+  size_t size = 0;
+  void *data = _vprec_os_map_file(filename, &size, &error);
+  if (data == NULL)
+    return false;
+  if (!_vfi_profile_is_binary(data, size)) {
+    _vfi_parse_profile(ctx, data, size);
+    _vprec_os_unmap_file(data, size);
+    return true;
+  }
+
+  if (_vfi_profile_map(data, size, &ctx->vfi->profile_tables) != 0) {
+    logger_error("Binary profile %s is corrupted or was written for another "
+                 "version of the backend, convert it again",
+                 filename);
+  }
+  ctx->vfi->profile_map = data;
+  ctx->vfi->profile_map_size = size;
+  _vfi_use_profile(ctx, &ctx->vfi->profile_tables);
+  return true;
+}
+
+/* Node-wide shared profiles */
+
+/* times a process retries with a 1 ms pause while the segment it opened */
+/* is not locked by its creator yet */
+#define VFI_SHARED_RETRIES 1000
+
+/* first page of the shared memory segment, the binary profile follows. */
+/* The creator holds an exclusive lock on the segment until it is written */
+typedef struct {
+  /* size of the binary profile, set once it is written */
+  uint64_t size;
+  /* number of processes using the profile, the last one unlinks it. The */
+  /* processes that crash are never uncounted, their segment is left in */
+  /* /dev/shm and reused by the next runs */
+  uint32_t nb_users;
+} _vfi_shared_header_t;
+
+#define VFI_ALIGN8(n) (((n) + 7) & ~(uint64_t)7)
+
+static void _vfi_free_profile(vprec_context_t *ctx);
+
+/* name the shared memory segment of the text profile filename after the */
+/* version of the file, return false for binary profiles which are already */
+/* shared through the page cache */
+static IBool _vfi_shared_name(const char *filename,
+                              char name[VFI_SHARED_NAME_SIZE]) {
+  int error = 0;
+  int fd = _vprec_os_open_file(filename, &error);
+  if (fd == -1)
+    return false;
+  _vprec_os_file_info_t info;
+  char magic[sizeof(VFI_PROFILE_MAGIC)];
+  IBool text = _vprec_os_file_info(fd, &info, &error) && info.regular &&
+               info.size > 0 &&
+               !(_vprec_os_read(fd, magic, sizeof(magic), &error) ==
+                     sizeof(magic) &&
+                 _vfi_profile_is_binary(magic, sizeof(magic)));
+  _vprec_os_close_file(fd, false, &error);
+  if (!text)
+    return false;
+
+  /* at most 5 numbers of 20 digits */
+  char key[128];
+  interflop_sprintf(key, "%d:%llu:%llu:%zu:%lld.%ld", VFI_PROFILE_VERSION,
+                    (unsigned long long)info.dev,
+                    (unsigned long long)info.ino, info.size, info.mtime_sec,
+                    info.mtime_nsec);
+  /* 13 + 10 + 1 + 16 characters */
+  interflop_sprintf(name, "/vfi-profile-%u-%016llx",
+                    (unsigned)_vprec_os_getuid(),
+                    (unsigned long long)_vfi_profile_hash(key));
+  return true;
+}
+
+/* offsets of the sections of the binary profile holding the functions of */
+/* the parsed text profile */
+static void _vfi_shared_layout(vprec_context_t *ctx,
+                               _vfi_profile_file_t *header) {
+  uint32_t nb_functions = ctx->vfi->index.nb_keys;
+  uint64_t nb_arguments = 0;
+  uint64_t strings_size = 0;
+  for (uint32_t slot = 0; slot < nb_functions; slot++) {
+    const _vfi_t *function = ctx->vfi->profile_slots[slot];
+    nb_arguments += function->nb_input_args + function->nb_output_args;
+    strings_size += strlen(function->id) + 1;
+    for (int i = 0; i < function->nb_input_args; i++)
+      strings_size += strlen(function->input_args[i].arg_id) + 1;
+    for (int i = 0; i < function->nb_output_args; i++)
+      strings_size += strlen(function->output_args[i].arg_id) + 1;
+  }
+
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, VFI_PROFILE_MAGIC, sizeof(VFI_PROFILE_MAGIC));
+  header->version = VFI_PROFILE_VERSION;
+  header->function_record_size = sizeof(_vfi_profile_function_t);
+  header->argument_record_size = sizeof(_vfi_profile_argument_t);
+  header->nb_functions = nb_functions;
+  header->nb_arguments = nb_arguments;
+  header->nb_buckets = ctx->vfi->index.nb_buckets;
+  header->seeds = VFI_ALIGN8(sizeof(*header));
+  header->functions =
+      VFI_ALIGN8(header->seeds + header->nb_buckets * sizeof(uint32_t));
+  header->arguments = VFI_ALIGN8(
+      header->functions + nb_functions * sizeof(_vfi_profile_function_t));
+  header->histograms = VFI_ALIGN8(
+      header->arguments + nb_arguments * sizeof(_vfi_profile_argument_t));
+  header->index = header->histograms +
+                  nb_arguments * VFI_PROFILE_HIST_BINS * sizeof(uint64_t);
+  header->strings = VFI_ALIGN8(header->index + nb_functions * sizeof(uint32_t));
+  header->strings_size = strings_size;
+}
+
+/* append a string to the string table, return its offset */
+static uint32_t _vfi_shared_string(char *strings, uint64_t *used,
+                                   const char *string) {
+  uint64_t offset = *used;
+  size_t len = strlen(string) + 1;
+  memcpy(strings + offset, string, len);
+  *used += len;
+  return offset;
+}
+
+/* write the functions of the parsed text profile as a binary profile at */
+/* data, laid out by _vfi_shared_layout */
+static void _vfi_shared_fill(vprec_context_t *ctx,
+                             const _vfi_profile_file_t *header, char *data) {
+  _vfi_profile_function_t *functions =
+      (_vfi_profile_function_t *)(data + header->functions);
+  _vfi_profile_argument_t *arguments =
+      (_vfi_profile_argument_t *)(data + header->arguments);
+  uint64_t *histograms = (uint64_t *)(data + header->histograms);
+  uint32_t *index = (uint32_t *)(data + header->index);
+  char *strings = data + header->strings;
+  uint64_t used = 0;
+  uint32_t nb_arguments = 0;
+
+  memcpy(data, header, sizeof(*header));
+  memcpy(data + header->seeds, ctx->vfi->index.seeds,
+         header->nb_buckets * sizeof(uint32_t));
+
+  for (uint32_t slot = 0; slot < header->nb_functions; slot++) {
+    const _vfi_t *function = ctx->vfi->profile_slots[slot];
+    _vfi_profile_function_t *record = &functions[slot];
+    record->id = _vfi_shared_string(strings, &used, function->id);
+    record->isLibraryFunction = function->isLibraryFunction;
+    record->isIntrinsicFunction = function->isIntrinsicFunction;
+    record->useFloat = function->useFloat;
+    record->useDouble = function->useDouble;
+    record->OpsPrec64 = function->OpsPrec64;
+    record->OpsRange64 = function->OpsRange64;
+    record->OpsPrec32 = function->OpsPrec32;
+    record->OpsRange32 = function->OpsRange32;
+    record->nb_input_args = function->nb_input_args;
+    record->nb_output_args = function->nb_output_args;
+    record->first_arg = nb_arguments;
+    record->n_calls = function->n_calls;
+
+    int nb_args = function->nb_input_args + function->nb_output_args;
+    for (int i = 0; i < nb_args; i++, nb_arguments++) {
+      const _vfi_argument_data_t *arg =
+          i < function->nb_input_args
+              ? &function->input_args[i]
+              : &function->output_args[i - function->nb_input_args];
+      _vfi_profile_argument_t *argument = &arguments[nb_arguments];
+      argument->arg_id = _vfi_shared_string(strings, &used, arg->arg_id);
+      argument->data_type = arg->data_type;
+      argument->mantissa_length = arg->mantissa_length;
+      argument->exponent_length = arg->exponent_length;
+      argument->min_range = arg->min_range;
+      argument->max_range = arg->max_range;
+      /* the histograms are only kept with an output profile */
+      for (int j = 0; arg->exponent_hist != NULL && j < VFI_HIST_BINS; j++)
+        histograms[nb_arguments * VFI_PROFILE_HIST_BINS + j] =
+            arg->exponent_hist[j];
+    }
+  }
+
+  /* slots of the functions ordered by id */
+  _vfi_entry_t *sorted =
+      interflop_malloc(header->nb_functions * sizeof(_vfi_entry_t));
+  for (uint32_t i = 0; i < header->nb_functions; i++)
+    sorted[i] = (_vfi_entry_t){ctx->vfi->profile_slots[i]->id,
+                               ctx->vfi->profile_slots[i], i};
+  qsort(sorted, header->nb_functions, sizeof(_vfi_entry_t), _vfi_compare_ids);
+  for (uint32_t i = 0; i < header->nb_functions; i++)
+    index[i] = sorted[i].slot;
+  interflop_free(sorted);
+}
+
+/* unlink the shared profile name if it still refers to the segment of */
+/* device dev and inode ino, which a newer run may have replaced. The inode */
+/* of a segment mapped by this process can't be reused */
+static void _vfi_shared_unlink(const char *name, dev_t dev, ino_t ino) {
+  int error = 0;
+  int fd = _vprec_os_shm_open(name, false, &error);
+  if (fd == -1)
+    return;
+  _vprec_os_file_info_t info;
+  IBool same = _vprec_os_file_info(fd, &info, &error) && info.dev == dev &&
+               info.ino == ino;
+  _vprec_os_close_file(fd, false, &error);
+  if (same)
+    _vprec_os_shm_unlink(name);
+}
+
+/* stop using the shared profile, unlinking it if no process uses it */
+static void _vfi_detach_shared_profile(vprec_context_t *ctx) {
+  _vfi_shared_header_t *header = ctx->vfi->profile_shm_header;
+  /* forked children inherit the mapping without being counted */
+  if (ctx->vfi->profile_shm_owner == _vprec_os_getpid() &&
+      __atomic_sub_fetch(&header->nb_users, 1, __ATOMIC_ACQ_REL) == 0)
+    _vfi_shared_unlink(ctx->vfi->profile_shm_name, ctx->vfi->profile_shm_dev,
+                       ctx->vfi->profile_shm_ino);
+  _vprec_os_unmap_file(header, _vprec_os_page_size());
+  ctx->vfi->profile_shm_name[0] = '\0';
+  ctx->vfi->profile_shm_header = NULL;
+}
+
+/* wait for the creator of the segment fd to release its lock, and fill */
+/* info with the segment then. Return false if fd can't be locked */
+static IBool _vfi_shared_wait(int fd, _vprec_os_file_info_t *info) {
+  size_t page = _vprec_os_page_size();
+  int error = 0;
+  for (int retry = 0;; retry++) {
+    /* the creator holds an exclusive lock until the profile is written, */
+    /* it gives up or it dies */
+    if (!_vprec_os_lock_file(fd, false, &error))
+      return false;
+    if (!_vprec_os_file_info(fd, info, &error))
+      return false;
+    /* a short segment was opened before its creator locked it, or the */
+    /* creator died before writing the header */
+    if (info->nlink == 0 || info->size >= page || retry == VFI_SHARED_RETRIES)
+      return true;
+    _vprec_os_unlock_file(fd);
+    _vprec_os_sleep_ms(1);
+  }
+}
+
+/* map the shared profile once it is written, the creator is already */
+/* counted as a user. Return false if the profile must be loaded privately */
+static IBool _vfi_join_shared_profile(vprec_context_t *ctx, int fd,
+                                      const char *name, IBool creator) {
+  size_t page = _vprec_os_page_size();
+  int error = 0;
+  _vfi_shared_header_t *header = NULL;
+  uint64_t size = 0;
+  _vprec_os_file_info_t info;
+
+  /* the creator unlinks the segment when it gives up */
+  if (_vfi_shared_wait(fd, &info) && info.nlink > 0) {
+    if (info.size >= page)
+      header = _vprec_os_map_shared(fd, page, 0, true, &error);
+    if (header != NULL)
+      size = __atomic_load_n(&header->size, __ATOMIC_ACQUIRE);
+    /* a segment left unwritten by a creator that died is unlinked, the */
+    /* next processes create a new one */
+    if (size == 0)
+      _vfi_shared_unlink(name, info.dev, info.ino);
+  }
+
+  void *data = NULL;
+  if (size != 0 && size <= info.size - page)
+    data = _vprec_os_map_shared(fd, size, page, false, &error);
+  _vprec_os_close_file(fd, false, &error);
+  if (data != NULL &&
+      _vfi_profile_map(data, size, &ctx->vfi->profile_tables) != 0) {
+    logger_warning("Shared profile %s is corrupted, parsing %s\n", name,
+                   ctx->vfi->vprec_input_file);
+    _vfi_shared_unlink(name, info.dev, info.ino);
+    _vprec_os_unmap_file(data, size);
+    data = NULL;
+  }
+  if (data == NULL) {
+    if (header != NULL && creator &&
+        __atomic_sub_fetch(&header->nb_users, 1, __ATOMIC_ACQ_REL) == 0)
+      _vfi_shared_unlink(name, info.dev, info.ino);
+    if (header != NULL)
+      _vprec_os_unmap_file(header, page);
+    return false;
+  }
+
+  if (!creator)
+    __atomic_add_fetch(&header->nb_users, 1, __ATOMIC_ACQ_REL);
+  size_t len = strnlen(name, VFI_SHARED_NAME_SIZE - 1);
+  memcpy(ctx->vfi->profile_shm_name, name, len);
+  ctx->vfi->profile_shm_name[len] = '\0';
+  ctx->vfi->profile_shm_header = header;
+  ctx->vfi->profile_shm_owner = _vprec_os_getpid();
+  ctx->vfi->profile_shm_dev = info.dev;
+  ctx->vfi->profile_shm_ino = info.ino;
+  ctx->vfi->profile_map = data;
+  ctx->vfi->profile_map_size = size;
+  _vfi_use_profile(ctx, &ctx->vfi->profile_tables);
+  return true;
+}
+
+/* parse the text profile and write it to the new shared memory segment, */
+/* return false if the input file can't be read */
+static IBool _vfi_create_shared_profile(vprec_context_t *ctx, int fd,
+                                        const char *name) {
+  size_t page = _vprec_os_page_size();
+  int error = 0;
+  /* left zeroed if unknown, the segment is then removed by the processes */
+  /* that find it unwritten */
+  _vprec_os_file_info_t info = {0};
+
+  /* locked before the header is visible, released when fd is closed */
+  _vfi_shared_header_t *header = NULL;
+  if (_vprec_os_lock_file(fd, true, &error) &&
+      _vprec_os_file_info(fd, &info, &error) &&
+      _vprec_os_resize_file(fd, page, false, &error))
+    header = _vprec_os_map_shared(fd, page, 0, true, &error);
+  if (header == NULL) {
+    _vfi_shared_unlink(name, info.dev, info.ino);
+    _vprec_os_close_file(fd, false, &error);
+    return false;
+  }
+
+  IBool parsed = _vfi_map_profile(ctx);
+  _vfi_profile_file_t layout;
+  size_t size = 0;
+  void *data = NULL;
+  /* nothing to share if the profile is empty or has no perfect hash */
+  if (parsed && ctx->vfi->profile_slots != NULL) {
+    _vfi_shared_layout(ctx, &layout);
+    size = layout.strings + layout.strings_size;
+    /* the pages are reserved up front: writing a sparse tmpfs file that */
+    /* runs out of space would raise SIGBUS */
+    if (_vprec_os_resize_file(fd, page + size, true, &error))
+      data = _vprec_os_map_shared(fd, size, page, true, &error);
+    if (data == NULL)
+      logger_warning("Can't share the input profile %s: %s\n",
+                     ctx->vfi->vprec_input_file, interflop_strerror(error));
+  }
+  if (data == NULL) {
+    /* the waiting processes parse the profile themselves */
+    _vfi_shared_unlink(name, info.dev, info.ino);
+    _vprec_os_unmap_file(header, page);
+    _vprec_os_close_file(fd, false, &error);
+    return parsed;
+  }
+
+  _vfi_shared_fill(ctx, &layout, data);
+  _vprec_os_unmap_file(data, size);
+  header->nb_users = 1;
+  __atomic_store_n(&header->size, size, __ATOMIC_RELEASE);
+  _vprec_os_unmap_file(header, page);
+
+  /* use the shared copy like the other processes */
+  _vfi_free_profile(ctx);
+  _vfi_arena_free(&ctx->vfi->arena);
+  return _vfi_join_shared_profile(ctx, fd, name, true);
+}
+
+/* use the text input profile shared by the processes of the node, */
+/* writing it if this process comes first. Return false if the profile must */
+/* be loaded privately */
+static IBool _vfi_share_profile(vprec_context_t *ctx) {
+  char name[VFI_SHARED_NAME_SIZE];
+  if (!_vfi_shared_name(ctx->vfi->vprec_input_file, name))
+    return false;
+
+  int error = 0;
+  int fd = _vprec_os_shm_open(name, true, &error);
+  if (fd != -1)
+    return _vfi_create_shared_profile(ctx, fd, name);
+  if (error != EEXIST || (fd = _vprec_os_shm_open(name, false, &error)) == -1)
+    return false;
+  return _vfi_join_shared_profile(ctx, fd, name, false);
+}
+
+/* unload the input profile, its functions are released with the arena */
+static void _vfi_free_profile(vprec_context_t *ctx) {
+  if (ctx->vfi->profile_slots == NULL)
+    return;
+
+  interflop_free(ctx->vfi->profile_slots);
+
+  if (ctx->vfi->profile_handle != NULL) {
+    dlclose(ctx->vfi->profile_handle);
+  } else if (ctx->vfi->profile_map != NULL) {
+    _vprec_os_unmap_file(ctx->vfi->profile_map, ctx->vfi->profile_map_size);
+    if (ctx->vfi->profile_shm_header != NULL)
+      _vfi_detach_shared_profile(ctx);
+  } else {
+    _vfi_mph_free(&ctx->vfi->index);
+  }
+
+  ctx->vfi->index.nb_keys = 0;
+  ctx->vfi->profile_slots = NULL;
+  ctx->vfi->profile = NULL;
+  ctx->vfi->profile_handle = NULL;
+  ctx->vfi->profile_map = NULL;
+  ctx->vfi->profile_map_size = 0;
+}
+
+/* return the instrumented function with the given id, or NULL if unknown, */
+/* with the lock of the context held */
+static _vfi_t *_vfi_lookup(vprec_context_t *ctx, const char *id) {
+  if (ctx->vfi->index.nb_keys > 0) {
+    uint32_t slot = _vfi_mph_lookup(&ctx->vfi->index, id);
+    _vfi_t *function = ctx->vfi->profile_slots[slot];
+    if (function == NULL) {
+      // not created yet: compare with the id of the compiled record
+      const _vfi_profile_t *profile = ctx->vfi->profile;
+      if (interflop_strcmp(profile->strings + profile->functions[slot].id,
+                           id) == 0)
+        return _vfi_profile_materialize(ctx, slot);
+    } else if (interflop_strcmp(function->id, id) == 0) {
+      return function;
+    }
+  }
+  // functions missing from the input profile
+  return vfc_hashmap_get(ctx->vfi->map, vfc_hashmap_str_function(id));
+}
+
+/* create the function of a call site missing from the input profile and */
+/* insert it in the hashmap, with the lock of the context held */
+static _vfi_t *_vfi_create_function(vprec_context_t *ctx,
+                                    const interflop_function_info_t *site) {
+  _vfi_t *function = _vfi_arena_alloc(&ctx->vfi->arena, sizeof(_vfi_t));
+
+  // initialize the structure
+  function->id = _vfi_intern(&ctx->vfi->strings, site->id);
+  function->isLibraryFunction = site->isLibraryFunction;
+  function->isIntrinsicFunction = site->isIntrinsicFunction;
+  function->useFloat = site->useFloat;
+  function->useDouble = site->useDouble;
+  function->OpsRange64 = VPREC_RANGE_BINARY64_DEFAULT;
+  function->OpsPrec64 = VPREC_PRECISION_BINARY64_DEFAULT;
+  function->OpsRange32 = VPREC_RANGE_BINARY32_DEFAULT;
+  function->OpsPrec32 = VPREC_PRECISION_BINARY32_DEFAULT;
+  function->nb_input_args = 0;
+  function->input_args = NULL;
+  function->nb_output_args = 0;
+  function->output_args = NULL;
+  function->n_calls = 0;
+  function->flags = 0;
+  function->log_generation = 0;
+
+  // insert the function in the hashmap
+  vfc_hashmap_insert(ctx->vfi->map, vfc_hashmap_str_function(site->id),
+                     function);
+  return function;
+}
+
+/* Call site cache */
+
+#define VFI_SITE_CACHE_INIT_CAPACITY 1024
+
+/* call sites resolved by the current thread, each thread fills its own */
+/* table so that resolved call sites are looked up without locking */
+static __thread _vfi_site_cache_t _vfi_site_cache = {NULL, 0, 0, 0};
+
+/* frees the table of a thread when it exits */
+static pthread_key_t _vfi_site_cache_key;
+static pthread_once_t _vfi_site_cache_once = PTHREAD_ONCE_INIT;
+
+static inline size_t _vfi_site_hash(const interflop_function_info_t *site,
+                                    size_t capacity) {
+  return (((uintptr_t)site >> 4) * 0x9e3779b97f4a7c15ULL) & (capacity - 1);
+}
+
+static void _vfi_site_cache_free(_vfi_site_cache_t *cache) {
+  interflop_free(cache->sites);
+  cache->sites = NULL;
+  cache->capacity = 0;
+  cache->nb_items = 0;
+  cache->generation = 0;
+}
+
+static void _vfi_site_cache_destroy(void *cache) {
+  _vfi_site_cache_free((_vfi_site_cache_t *)cache);
+}
+
+static void _vfi_site_cache_create_key(void) {
+  pthread_key_create(&_vfi_site_cache_key, _vfi_site_cache_destroy);
+}
+
+static void _vfi_site_cache_init(_vfi_site_cache_t *cache, int generation) {
+  cache->capacity = VFI_SITE_CACHE_INIT_CAPACITY;
+  cache->nb_items = 0;
+  cache->sites = interflop_calloc(cache->capacity, sizeof(_vfi_site_t));
+  cache->generation = generation;
+  pthread_once(&_vfi_site_cache_once, _vfi_site_cache_create_key);
+  pthread_setspecific(_vfi_site_cache_key, cache);
+}
+
+/* return the function resolved for site or NULL if it was never resolved */
+static inline _vfi_t *_vfi_site_get(_vfi_site_cache_t *cache,
+                                    const interflop_function_info_t *site) {
+  size_t i = _vfi_site_hash(site, cache->capacity);
+  while (cache->sites[i].site != NULL) {
+    if (cache->sites[i].site == site && cache->sites[i].id == site->id)
+      return cache->sites[i].function;
+    i = (i + 1) & (cache->capacity - 1);
+  }
+  return NULL;
+}
+
+static void _vfi_site_put(_vfi_site_cache_t *cache,
+                          const interflop_function_info_t *site,
+                          _vfi_t *function);
+
+/* double the capacity of the cache */
+static void _vfi_site_cache_grow(_vfi_site_cache_t *cache) {
+  _vfi_site_cache_t grown = {
+      .sites = interflop_calloc(2 * cache->capacity, sizeof(_vfi_site_t)),
+      .capacity = 2 * cache->capacity,
+      .nb_items = 0,
+      .generation = cache->generation};
+  for (size_t i = 0; i < cache->capacity; i++)
+    if (cache->sites[i].site != NULL)
+      _vfi_site_put(&grown, cache->sites[i].site, cache->sites[i].function);
+  interflop_free(cache->sites);
+  *cache = grown;
+}
+
+static void _vfi_site_put(_vfi_site_cache_t *cache,
+                          const interflop_function_info_t *site,
+                          _vfi_t *function) {
+  if (2 * (cache->nb_items + 1) > cache->capacity)
+    _vfi_site_cache_grow(cache);
+
+  size_t i = _vfi_site_hash(site, cache->capacity);
+  while (cache->sites[i].site != NULL && cache->sites[i].site != site)
+    i = (i + 1) & (cache->capacity - 1);
+  if (cache->sites[i].site == NULL)
+    cache->nb_items++;
+  cache->sites[i].site = site;
+  cache->sites[i].id = site->id;
+  cache->sites[i].function = function;
+}
+
+/* return the call site cache of the current thread, cleared if the */
+/* functions it refers to were freed */
+static inline _vfi_site_cache_t *_vfi_thread_site_cache(vprec_context_t *ctx) {
+  _vfi_site_cache_t *cache = &_vfi_site_cache;
+  if (cache->generation != ctx->vfi->site_generation) {
+    _vfi_site_cache_free(cache);
+    _vfi_site_cache_init(cache, ctx->vfi->site_generation);
+  }
+  return cache;
+}
+
+/* return the function of a call site, hashing its id only once per */
+/* thread. An unknown function is created if create is true, NULL is */
+/* returned otherwise */
+static inline _vfi_t *_vfi_resolve(vprec_context_t *ctx,
+                                   const interflop_function_info_t *site,
+                                   IBool create) {
+  _vfi_site_cache_t *cache = _vfi_thread_site_cache(ctx);
+  _vfi_t *function = _vfi_site_get(cache, site);
+  if (function == NULL) {
+    /* the other threads create and materialize functions meanwhile */
+    pthread_mutex_lock(&ctx->vfi->lock);
+    function = _vfi_lookup(ctx, site->id);
+    if (function == NULL && create)
+      function = _vfi_create_function(ctx, site);
+    pthread_mutex_unlock(&ctx->vfi->lock);
+    if (function != NULL)
+      _vfi_site_put(cache, site, function);
+  }
+  return function;
+}
+
+/* Set the internal operations precision and range of function, skipping */
+/* the writes when they are already set. The values are not validated, */
+/* functions of the input profile are checked when the profile is loaded */
+static inline void _vfi_set_ops_precision(vprec_context_t *ctx,
+                                          const _vfi_t *function) {
+  if (ctx->binary64_precision != function->OpsPrec64)
+    ctx->binary64_precision = function->OpsPrec64;
+  if (ctx->binary64_range != function->OpsRange64)
+    ctx->binary64_range = function->OpsRange64;
+  if (ctx->binary32_precision != function->OpsPrec32)
+    ctx->binary32_precision = function->OpsPrec32;
+  if (ctx->binary32_range != function->OpsRange32)
+    ctx->binary32_range = function->OpsRange32;
+}
+
+/* Shadow stack */
+
+#define VFI_SHADOW_STACK_INIT_CAPACITY 256
+
+/* functions entered and not exited yet by the current thread */
+static __thread _vfi_shadow_stack_t _vfi_shadow_stack = {NULL, 0, 0};
+
+/* push function and the internal operations configuration of the caller */
+static inline void _vfi_shadow_push(vprec_context_t *ctx, _vfi_t *function,
+                                    int traced) {
+  _vfi_shadow_stack_t *stack = &_vfi_shadow_stack;
+  if (stack->top == stack->capacity) {
+    size_t capacity = (stack->capacity == 0) ? VFI_SHADOW_STACK_INIT_CAPACITY
+                                             : 2 * stack->capacity;
+    _vfi_frame_t *grown = interflop_malloc(capacity * sizeof(_vfi_frame_t));
+    for (size_t i = 0; i < stack->top; i++)
+      grown[i] = stack->frames[i];
+    interflop_free(stack->frames);
+    stack->frames = grown;
+    stack->capacity = capacity;
+  }
+  _vfi_frame_t *frame = &stack->frames[stack->top++];
+  frame->function = function;
+  frame->binary64_precision = ctx->binary64_precision;
+  frame->binary64_range = ctx->binary64_range;
+  frame->binary32_precision = ctx->binary32_precision;
+  frame->binary32_range = ctx->binary32_range;
+  frame->traced = traced;
+}
+
+/* pop the frame of the function being exited, NULL if the stack is empty */
+static inline _vfi_frame_t *_vfi_shadow_pop(void) {
+  _vfi_shadow_stack_t *stack = &_vfi_shadow_stack;
+  return (stack->top == 0) ? NULL : &stack->frames[--stack->top];
+}
+
+/* forget the functions of the frames, they are resolved again on exit */
+static void _vfi_shadow_invalidate(void) {
+  for (size_t i = 0; i < _vfi_shadow_stack.top; i++)
+    _vfi_shadow_stack.frames[i].function = NULL;
+}
+
+static void _vfi_shadow_free(void) {
+  interflop_free(_vfi_shadow_stack.frames);
+  _vfi_shadow_stack.frames = NULL;
+  _vfi_shadow_stack.capacity = 0;
+  _vfi_shadow_stack.top = 0;
+}
+
+/* read the profile given by --prec-input-file into a fresh hashmap */
+static void _vfi_load_profile(vprec_context_t *ctx) {
+  ctx->vfi->map = vfc_hashmap_create();
+  /* read the hashmap */
+  if (ctx->vfi->vprec_input_file != NULL &&
+      _vfi_is_compiled_profile(ctx->vfi->vprec_input_file)) {
+    _vfi_load_compiled_profile(ctx);
+  } else if (ctx->vfi->vprec_input_file != NULL && ctx->vfi->input_shared &&
+             _vfi_share_profile(ctx)) {
+    /* shared by the processes of the node, or parsed if it can't be */
+  } else if (ctx->vfi->vprec_input_file != NULL &&
+             _vfi_map_profile(ctx)) {
+    /* binary profiles are used in place, text ones are already parsed */
+  } else if (ctx->vfi->vprec_input_file != NULL) {
+    int error = 0;
+    File *f = interflop_fopen(ctx->vfi->vprec_input_file, "r", &error);
+    if (f != NULL) {
+      _vfi_read_hasmap(f, ctx);
+      interflop_fclose(f);
+    } else {
+      logger_error("Input file can't be found: %s", interflop_strerror(error));
+    }
+  }
+}
+
+/* compile the regular expression given by --prec-log-functions */
+static void _vfi_compile_log_filter(vprec_context_t *ctx) {
+  if (ctx->vfi->log_functions_compiled) {
+    regfree(&ctx->vfi->log_functions_regex);
+    ctx->vfi->log_functions_compiled = false;
+  }
+  if (ctx->vfi->vprec_log_functions == NULL)
+    return;
+
+  int error = regcomp(&ctx->vfi->log_functions_regex,
+                      ctx->vfi->vprec_log_functions, REG_EXTENDED | REG_NOSUB);
+  if (error != 0) {
+    char message[256];
+    regerror(error, &ctx->vfi->log_functions_regex, message, sizeof(message));
+    logger_error("--%s invalid regular expression %s: %s",
+                 key_log_functions_str, ctx->vfi->vprec_log_functions,
+                 message);
+  }
+  ctx->vfi->log_functions_compiled = true;
+}
+
+/* open the file given by --prec-log-file */
+static void _vfi_open_log(vprec_context_t *ctx) {
+  if (ctx->vfi->vprec_log_file != NULL) {
+    int error = 0;
+    File *f = interflop_fopen(ctx->vfi->vprec_log_file, "w", &error);
+    if (f != NULL) {
+      _vprec_log_file = f;
+      /* the filters are checked again and the calls counted from zero */
+      _vfi_compile_log_filter(ctx);
+      ctx->vfi->log_generation++;
+      _vfi_log_start(f, ctx->vfi->vprec_log_format, true);
+    } else {
+      logger_error("Error while opening %s: %s", ctx->vfi->vprec_log_file,
+                   interflop_strerror(error));
+    }
+  }
+}
+
+/* initialize the variables to run vprec function instrumentation */
+void _vfi_init(void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+
+  /* the workers also parse the text profile */
+  if (ctx->vfi->nb_threads > 1) {
+    ctx->vfi->pool = _vprec_pool_create(ctx->vfi->nb_threads);
+    if (ctx->vfi->pool == NULL)
+      logger_warning("Can't create the %d threads of --%s, large pointer "
+                     "arguments are processed by the calling thread\n",
+                     ctx->vfi->nb_threads, key_instrument_threads_str);
+  }
+
+  /* Initialize the vprec_function_map */
+  _vfi_string_pool_init(&ctx->vfi->strings);
+  _vfi_load_profile(ctx);
+  _vfi_open_log(ctx);
+  ctx->vfi->trace_args =
+      (ctx->vfi->vprec_output_file != NULL && ctx->vfi->track_ranges) ||
+      _vprec_log_file != NULL;
+
+  if (!ctx->vfi->track_ranges && _vprec_log_file == NULL)
+    logger_warning("--%s is set without --%s, the argument ranges are not "
+                   "recorded anywhere\n",
+                   key_instrument_no_ranges_str, key_log_file_str);
+  _vfi_checkpoint_start(ctx);
+}
+
+/* reload the profile and/or reopen the log file after their paths changed */
+void _vfi_reload(void *context, IBool reload_profile, IBool reopen_log) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+
+  /* the pending log records refer to the ids of the profile */
+  if (_vprec_log_file != NULL)
+    _vfi_log_stop();
+
+  if (reload_profile) {
+    /* the checkpoint thread reads the functions freed below */
+    _vfi_checkpoint_stop();
+    vfc_hashmap_destroy(ctx->vfi->map);
+    _vfi_free_profile(ctx);
+    _vfi_arena_free(&ctx->vfi->arena);
+    _vfi_load_profile(ctx);
+    /* the resolved functions were freed */
+    ctx->vfi->site_generation++;
+    _vfi_shadow_invalidate();
+    _vfi_checkpoint_start(ctx);
+  }
+
+  if (reopen_log) {
+    if (_vprec_log_file != NULL) {
+      interflop_fclose(_vprec_log_file);
+      _vprec_log_file = NULL;
+    }
+    _vfi_open_log(ctx);
+  } else if (_vprec_log_file != NULL) {
+    _vfi_log_start(_vprec_log_file, ctx->vfi->vprec_log_format, false);
+  }
+
+  ctx->vfi->trace_args =
+      (ctx->vfi->vprec_output_file != NULL && ctx->vfi->track_ranges) ||
+      _vprec_log_file != NULL;
+}
+
+/* free objects and close files */
+void _vfi_flush_log(void *context) {
+  (void)context;
+  if (_vprec_log_file != NULL)
+    _vfi_log_drain();
+}
+
+void _vfi_finalize(void *context) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+
+  /* the last checkpoint would race with the final profile */
+  _vfi_checkpoint_stop();
+
+  /* save the hashmap */
+  if (ctx->vfi->vprec_output_file != NULL) {
+    /* threads still running may create functions meanwhile */
+    pthread_mutex_lock(&ctx->vfi->lock);
+    size_t nb_functions;
+    _vfi_entry_t *functions = _vfi_collect_functions(ctx, &nb_functions);
+    pthread_mutex_unlock(&ctx->vfi->lock);
+    int error = _vfi_save_profile(ctx->vfi->vprec_output_file,
+                                  ctx->vfi->profile, functions, nb_functions);
+    interflop_free(functions);
+    if (error != 0)
+      logger_error("Output file can't be written: %s",
+                   interflop_strerror(error));
+  }
+
+  /* write the pending log records and close log file */
+  if (_vprec_log_file != NULL) {
+    _vfi_log_close();
+    interflop_fclose(_vprec_log_file);
+  }
+  if (ctx->vfi->log_functions_compiled) {
+    regfree(&ctx->vfi->log_functions_regex);
+    ctx->vfi->log_functions_compiled = false;
+  }
+
+  /* destroy vprec_function_map, its functions are in the arena */
+  vfc_hashmap_destroy(ctx->vfi->map);
+
+  /* free the input profile */
+  _vfi_free_profile(ctx);
+
+  /* free all the functions and their arguments at once */
+  _vfi_arena_free(&ctx->vfi->arena);
+
+  /* free the call site cache of the finalizing thread, the caches of the */
+  /* other threads are freed when they exit */
+  _vfi_site_cache_free(&_vfi_site_cache);
+
+  /* free the ids, after the functions using them */
+  _vfi_string_pool_free(&ctx->vfi->strings);
+
+  /* free the shadow stack of the finalizing thread */
+  _vfi_shadow_free();
+
+  /* stop the workers */
+  if (ctx->vfi->pool != NULL) {
+    _vprec_pool_destroy(ctx->vfi->pool);
+    ctx->vfi->pool = NULL;
+  }
+}
+
+/* Arguments */
+
+/* initialize the metadata of an argument seen for the first time */
+static void _vfi_init_argument(vprec_context_t *ctx, _vfi_argument_data_t *arg,
+                               int type, const char *arg_id) {
+  arg->data_type = type;
+  arg->handler = _vfi_argument_handler(type);
+  arg->arg_id = _vfi_intern(&ctx->vfi->strings, arg_id);
+  arg->min_range = INT_MAX;
+  arg->max_range = INT_MIN;
+  arg->exponent_hist = _vfi_alloc_histograms(ctx, 1);
+  arg->exponent_length = (type == FDOUBLE || type == FDOUBLE_PTR)
+                             ? VPREC_RANGE_BINARY64_DEFAULT
+                             : VPREC_RANGE_BINARY32_DEFAULT;
+  arg->mantissa_length = (type == FDOUBLE || type == FDOUBLE_PTR)
+                             ? VPREC_PRECISION_BINARY64_DEFAULT
+                             : VPREC_PRECISION_BINARY32_DEFAULT;
+}
+
+/* convert a rounded bound of a range to int, saturating on overflow */
+static inline int _vfi_range_bound(double bound) {
+  if (bound >= (double)INT_MAX)
+    return INT_MAX;
+  if (bound <= (double)INT_MIN)
+    return INT_MIN;
+  return (int)bound;
+}
+
+/* Exponent histograms */
+
+/* bin of a nonzero finite value whose unbiased exponent is exp */
+static inline int _vfi_hist_bin(int exp) {
+  int magnitude = (exp < 0) ? -exp : exp;
+  int bits = (magnitude == 0) ? 0 : 32 - __builtin_clz(magnitude);
+  return VFI_HIST_EXP_BITS + 1 + ((exp < 0) ? -bits : bits);
+}
+
+/* count value in the exponent histogram of arg, if any, reading only its */
+/* bits. Return 0 for NaN and infinities, which are not counted */
+static inline int _vfi_hist_binary64(_vfi_argument_data_t *arg,
+                                     double value) {
+  binary64 x = {.f64 = value};
+  int biased = (x.u64 & DOUBLE_GET_EXP) >> DOUBLE_PMAN_SIZE;
+  uint64_t mantissa = x.u64 & ((1ULL << DOUBLE_PMAN_SIZE) - 1);
+  int exp;
+
+  if (biased == (int)(DOUBLE_GET_EXP >> DOUBLE_PMAN_SIZE))
+    return 0;
+  if (biased != 0) {
+    exp = biased - DOUBLE_EXP_COMP;
+  } else if (mantissa != 0) {
+    // subnormal: the exponent is the one of the leading bit of the mantissa
+    exp = 1 - DOUBLE_EXP_COMP - DOUBLE_PMAN_SIZE + 63 -
+          __builtin_clzll(mantissa);
+  } else {
+    if (arg->exponent_hist != NULL)
+      arg->exponent_hist[VFI_HIST_ZERO]++;
+    return 1;
+  }
+  if (arg->exponent_hist != NULL)
+    arg->exponent_hist[_vfi_hist_bin(exp)]++;
+  return 1;
+}
+
+/* binary32 version of _vfi_hist_binary64 */
+static inline int _vfi_hist_binary32(_vfi_argument_data_t *arg, float value) {
+  binary32 x = {.f32 = value};
+  int biased = (x.u32 & FLOAT_GET_EXP) >> FLOAT_PMAN_SIZE;
+  uint32_t mantissa = x.u32 & ((1U << FLOAT_PMAN_SIZE) - 1);
+  int exp;
+
+  if (biased == (int)(FLOAT_GET_EXP >> FLOAT_PMAN_SIZE))
+    return 0;
+  if (biased != 0) {
+    exp = biased - FLOAT_EXP_COMP;
+  } else if (mantissa != 0) {
+    // subnormal: the exponent is the one of the leading bit of the mantissa
+    exp = 1 - FLOAT_EXP_COMP - FLOAT_PMAN_SIZE + 31 - __builtin_clz(mantissa);
+  } else {
+    if (arg->exponent_hist != NULL)
+      arg->exponent_hist[VFI_HIST_ZERO]++;
+    return 1;
+  }
+  if (arg->exponent_hist != NULL)
+    arg->exponent_hist[_vfi_hist_bin(exp)]++;
+  return 1;
+}
+
+/* round a binary64 value if requested and update the range of arg */
+static inline void _vfi_round_binary64(vprec_context_t *ctx,
+                                       _vfi_argument_data_t *arg,
+                                       double *value, char is_input,
+                                       int new_flag, int mode_flag) {
+  if ((!new_flag) && mode_flag) {
+    *value = _vprec_round_binary64(*value, is_input, ctx, arg->exponent_length,
+                                   arg->mantissa_length);
+  }
+
+  // floor(x) < min and ceil(x) > max are x < min and x > max for integers
+  if (_vfi_hist_binary64(arg, *value)) {
+    if (*value < arg->min_range)
+      arg->min_range = _vfi_range_bound(interflop_floor(*value));
+    if (*value > arg->max_range)
+      arg->max_range = _vfi_range_bound(interflop_ceil(*value));
+  }
+}
+
+/* round a binary32 value if requested and update the range of arg */
+static inline void _vfi_round_binary32(vprec_context_t *ctx,
+                                       _vfi_argument_data_t *arg, float *value,
+                                       char is_input, int new_flag,
+                                       int mode_flag) {
+  if ((!new_flag) && mode_flag) {
+    *value = _vprec_round_binary32(*value, is_input, ctx, arg->exponent_length,
+                                   arg->mantissa_length);
+  }
+
+  // floor(x) < min and ceil(x) > max are x < min and x > max for integers
+  if (_vfi_hist_binary32(arg, *value)) {
+    if (*value < arg->min_range)
+      arg->min_range = _vfi_range_bound(interflop_floor(*value));
+    if (*value > arg->max_range)
+      arg->max_range = _vfi_range_bound(interflop_ceil(*value));
+  }
+}
+
+/* Vectorized range of pointer arguments */
+
+#define VFI_LANES_BINARY64 4
+#define VFI_LANES_BINARY32 8
+
+typedef double _vfi_v4df __attribute__((vector_size(32)));
+typedef int64_t _vfi_v4di __attribute__((vector_size(32)));
+typedef float _vfi_v8sf __attribute__((vector_size(32)));
+typedef int32_t _vfi_v8si __attribute__((vector_size(32)));
+
+/* select a where mask is set and b elsewhere */
+#define _vfi_select(T, I, mask, a, b)                                          \
+  ((T)(((I)(a) & (mask)) | ((I)(b) & ~(mask))))
+
+/* update the range of arg with the finite values in [min, max] */
+static inline void _vfi_merge_range(_vfi_argument_data_t *arg, double min,
+                                    double max) {
+  // no finite value
+  if (min > max)
+    return;
+  if (interflop_floor(min) < arg->min_range)
+    arg->min_range = _vfi_range_bound(interflop_floor(min));
+  if (interflop_ceil(max) > arg->max_range)
+    arg->max_range = _vfi_range_bound(interflop_ceil(max));
+}
+
+/* round the size elements of value if round is set and update the range of */
+/* arg with their finite values, in one pass */
+static void _vfi_scan_binary64(vprec_context_t *ctx, _vfi_argument_data_t *arg,
+                               double *value, unsigned int size, char is_input,
+                               int round) {
+  const _vfi_v4df inf = {INFINITY, INFINITY, INFINITY, INFINITY};
+  _vfi_v4df vmin = inf, vmax = -inf;
+  unsigned int j = 0;
+
+  for (; j + VFI_LANES_BINARY64 <= size; j += VFI_LANES_BINARY64) {
+    if (round) {
+      for (int k = 0; k < VFI_LANES_BINARY64; k++)
+        value[j + k] =
+            _vprec_round_binary64(value[j + k], is_input, ctx,
+                                  arg->exponent_length, arg->mantissa_length);
+    }
+    for (int k = 0; k < VFI_LANES_BINARY64; k++)
+      _vfi_hist_binary64(arg, value[j + k]);
+    _vfi_v4df x;
+    memcpy(&x, value + j, sizeof(x));
+    // x - x is 0 for finite values and NaN for NaN and infinities
+    _vfi_v4di finite = (x - x) == 0;
+    _vfi_v4df lo = _vfi_select(_vfi_v4df, _vfi_v4di, finite, x, inf);
+    _vfi_v4df hi = _vfi_select(_vfi_v4df, _vfi_v4di, finite, x, -inf);
+    vmin = _vfi_select(_vfi_v4df, _vfi_v4di, lo < vmin, lo, vmin);
+    vmax = _vfi_select(_vfi_v4df, _vfi_v4di, hi > vmax, hi, vmax);
+  }
+
+  double min = INFINITY, max = -INFINITY;
+  for (int k = 0; k < VFI_LANES_BINARY64; k++) {
+    min = (vmin[k] < min) ? vmin[k] : min;
+    max = (vmax[k] > max) ? vmax[k] : max;
+  }
+  for (; j < size; j++) {
+    if (round)
+      value[j] = _vprec_round_binary64(value[j], is_input, ctx,
+                                       arg->exponent_length,
+                                       arg->mantissa_length);
+    if (_vfi_hist_binary64(arg, value[j])) {
+      min = (value[j] < min) ? value[j] : min;
+      max = (value[j] > max) ? value[j] : max;
+    }
+  }
+  _vfi_merge_range(arg, min, max);
+}
+
+/* binary32 version of _vfi_scan_binary64 */
+static void _vfi_scan_binary32(vprec_context_t *ctx, _vfi_argument_data_t *arg,
+                               float *value, unsigned int size, char is_input,
+                               int round) {
+  const _vfi_v8sf inf = {INFINITY, INFINITY, INFINITY, INFINITY,
+                         INFINITY, INFINITY, INFINITY, INFINITY};
+  _vfi_v8sf vmin = inf, vmax = -inf;
+  unsigned int j = 0;
+
+  for (; j + VFI_LANES_BINARY32 <= size; j += VFI_LANES_BINARY32) {
+    if (round) {
+      for (int k = 0; k < VFI_LANES_BINARY32; k++)
+        value[j + k] =
+            _vprec_round_binary32(value[j + k], is_input, ctx,
+                                  arg->exponent_length, arg->mantissa_length);
+    }
+    for (int k = 0; k < VFI_LANES_BINARY32; k++)
+      _vfi_hist_binary32(arg, value[j + k]);
+    _vfi_v8sf x;
+    memcpy(&x, value + j, sizeof(x));
+    // x - x is 0 for finite values and NaN for NaN and infinities
+    _vfi_v8si finite = (x - x) == 0;
+    _vfi_v8sf lo = _vfi_select(_vfi_v8sf, _vfi_v8si, finite, x, inf);
+    _vfi_v8sf hi = _vfi_select(_vfi_v8sf, _vfi_v8si, finite, x, -inf);
+    vmin = _vfi_select(_vfi_v8sf, _vfi_v8si, lo < vmin, lo, vmin);
+    vmax = _vfi_select(_vfi_v8sf, _vfi_v8si, hi > vmax, hi, vmax);
+  }
+
+  float min = INFINITY, max = -INFINITY;
+  for (int k = 0; k < VFI_LANES_BINARY32; k++) {
+    min = (vmin[k] < min) ? vmin[k] : min;
+    max = (vmax[k] > max) ? vmax[k] : max;
+  }
+  for (; j < size; j++) {
+    if (round)
+      value[j] = _vprec_round_binary32(value[j], is_input, ctx,
+                                       arg->exponent_length,
+                                       arg->mantissa_length);
+    if (_vfi_hist_binary32(arg, value[j])) {
+      min = (value[j] < min) ? value[j] : min;
+      max = (value[j] > max) ? value[j] : max;
+    }
+  }
+  _vfi_merge_range(arg, min, max);
+}
+
+/* Parallel range of large pointer arguments */
+
+/* number of tasks per thread, for load balancing */
+#define VFI_TASKS_PER_THREAD 4
+
+typedef struct {
+  vprec_context_t *ctx;
+  const _vfi_argument_data_t *arg;
+  void *value;
+  unsigned int size;
+  unsigned int chunk;
+  char is_input;
+  int round;
+  // range of the chunk of each task
+  _vfi_argument_data_t *ranges;
+  // exponent histogram of the chunk of each task, NULL if arg has none
+  ISize_t *histograms;
+} _vfi_scan_job_t;
+
+/* round and scan the k-th chunk of a pointer argument */
+static void _vfi_scan_task(void *arg, int k) {
+  _vfi_scan_job_t *job = (_vfi_scan_job_t *)arg;
+  unsigned int begin = k * job->chunk;
+  unsigned int end =
+      (job->size - begin < job->chunk) ? job->size : begin + job->chunk;
+  _vfi_argument_data_t *range = &job->ranges[k];
+
+  *range = *job->arg;
+  range->min_range = INT_MAX;
+  range->max_range = INT_MIN;
+  range->exponent_hist =
+      job->histograms ? &job->histograms[k * VFI_HIST_BINS] : NULL;
+  if (job->arg->data_type == FDOUBLE_PTR) {
+    _vfi_scan_binary64(job->ctx, range, (double *)job->value + begin,
+                       end - begin, job->is_input, job->round);
+  } else {
+    _vfi_scan_binary32(job->ctx, range, (float *)job->value + begin,
+                       end - begin, job->is_input, job->round);
+  }
+}
+
+/* _vfi_scan_binary64/32 split across the workers of the pool, the ranges */
+/* of the chunks are merged at the end */
+static void _vfi_scan_parallel(vprec_context_t *ctx, _vfi_argument_data_t *arg,
+                               void *value, unsigned int size, char is_input,
+                               int round) {
+  int nb_tasks = VFI_TASKS_PER_THREAD * _vprec_pool_size(ctx->vfi->pool);
+  _vfi_scan_job_t job = {
+      .ctx = ctx,
+      .arg = arg,
+      .value = value,
+      .size = size,
+      .chunk = (size + nb_tasks - 1) / nb_tasks,
+      .is_input = is_input,
+      .round = round,
+      .ranges = interflop_malloc(nb_tasks * sizeof(_vfi_argument_data_t)),
+      .histograms = arg->exponent_hist
+                        ? interflop_calloc(nb_tasks * VFI_HIST_BINS,
+                                           sizeof(ISize_t))
+                        : NULL};
+  nb_tasks = (size + job.chunk - 1) / job.chunk;
+
+  _vprec_pool_run(ctx->vfi->pool, nb_tasks, _vfi_scan_task, &job);
+
+  for (int k = 0; k < nb_tasks; k++) {
+    if (job.ranges[k].min_range < arg->min_range)
+      arg->min_range = job.ranges[k].min_range;
+    if (job.ranges[k].max_range > arg->max_range)
+      arg->max_range = job.ranges[k].max_range;
+    for (int i = 0; job.histograms != NULL && i < VFI_HIST_BINS; i++)
+      arg->exponent_hist[i] += job.ranges[k].exponent_hist[i];
+  }
+  interflop_free(job.ranges);
+  interflop_free(job.histograms);
+}
+
+/* true if a pointer argument of size elements is split across threads */
+static inline int _vfi_is_parallel(vprec_context_t *ctx, unsigned int size) {
+  return ctx->vfi->pool != NULL && size >= ctx->vfi->parallel_threshold;
+}
+
+/* number of elements of a pointer argument of size elements that are */
+/* logged, the others are only scanned */
+static inline unsigned int _vfi_nb_logged(vprec_context_t *ctx,
+                                          unsigned int size, int traced) {
+  if (!(traced & VFI_LOGGED))
+    return 0;
+  return (size < (unsigned int)ctx->vfi->log_max_elements)
+             ? size
+             : (unsigned int)ctx->vfi->log_max_elements;
+}
+
+/* Argument handlers: round an input (is_input) or output argument of */
+/* function and update its range, value points to the argument or to the */
+/* first of its size elements. The first elements are logged if traced has */
+/* VFI_LOGGED. The handler of an argument is chosen from its type when the */
+/* argument is bound or loaded from the input profile */
+
+static void _vfi_handle_binary64(void *context, _vfi_t *function,
+                                 _vfi_argument_data_t *arg, char is_input,
+                                 const char *arg_id, unsigned int size,
+                                 void *value, int new_flag, int mode_flag,
+                                 int traced) {
+  (void)size;
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  binary64 *dvalue = (binary64 *)value;
+  uint64_t before = dvalue->u64;
+
+  _vfi_round_binary64(ctx, arg, &dvalue->f64, is_input, new_flag, mode_flag);
+  if (traced & VFI_LOGGED)
+    _vfi_log_argument(ctx, function, arg, is_input, FDOUBLE, arg_id, 0, before,
+                      dvalue->u64);
+}
+
+static void _vfi_handle_binary32(void *context, _vfi_t *function,
+                                 _vfi_argument_data_t *arg, char is_input,
+                                 const char *arg_id, unsigned int size,
+                                 void *value, int new_flag, int mode_flag,
+                                 int traced) {
+  (void)size;
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  binary32 *fvalue = (binary32 *)value;
+  uint32_t before = fvalue->u32;
+
+  _vfi_round_binary32(ctx, arg, &fvalue->f32, is_input, new_flag, mode_flag);
+  if (traced & VFI_LOGGED)
+    _vfi_log_argument(ctx, function, arg, is_input, FFLOAT, arg_id, 0, before,
+                      fvalue->u32);
+}
+
+static void _vfi_handle_binary64_ptr(void *context, _vfi_t *function,
+                                     _vfi_argument_data_t *arg, char is_input,
+                                     const char *arg_id, unsigned int size,
+                                     void *value, int new_flag, int mode_flag,
+                                     int traced) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  binary64 *dvalue = (binary64 *)value;
+  unsigned int nb_logged = _vfi_nb_logged(ctx, size, traced);
+
+  if (dvalue == NULL) {
+    for (unsigned int j = 0; j < nb_logged; j++)
+      _vfi_log_null(ctx, function, is_input, FDOUBLE_PTR, arg_id, j);
+  } else if (nb_logged == 0 && _vfi_is_parallel(ctx, size)) {
+    _vfi_scan_parallel(ctx, arg, dvalue, size, is_input,
+                       (!new_flag) && mode_flag);
+  } else {
+    for (unsigned int j = 0; j < nb_logged; j++, dvalue++) {
+      uint64_t before = dvalue->u64;
+      _vfi_round_binary64(ctx, arg, &dvalue->f64, is_input, new_flag,
+                          mode_flag);
+      _vfi_log_argument(ctx, function, arg, is_input, FDOUBLE_PTR, arg_id, j,
+                        before, dvalue->u64);
+    }
+    _vfi_scan_binary64(ctx, arg, &dvalue->f64, size - nb_logged, is_input,
+                       (!new_flag) && mode_flag);
+  }
+}
+
+static void _vfi_handle_binary32_ptr(void *context, _vfi_t *function,
+                                     _vfi_argument_data_t *arg, char is_input,
+                                     const char *arg_id, unsigned int size,
+                                     void *value, int new_flag, int mode_flag,
+                                     int traced) {
   vprec_context_t *ctx = (vprec_context_t *)context;
+  binary32 *fvalue = (binary32 *)value;
+  unsigned int nb_logged = _vfi_nb_logged(ctx, size, traced);
+
+  if (fvalue == NULL) {
+    for (unsigned int j = 0; j < nb_logged; j++)
+      _vfi_log_null(ctx, function, is_input, FFLOAT_PTR, arg_id, j);
+  } else if (nb_logged == 0 && _vfi_is_parallel(ctx, size)) {
+    _vfi_scan_parallel(ctx, arg, fvalue, size, is_input,
+                       (!new_flag) && mode_flag);
+  } else {
+    for (unsigned int j = 0; j < nb_logged; j++, fvalue++) {
+      uint32_t before = fvalue->u32;
+      _vfi_round_binary32(ctx, arg, &fvalue->f32, is_input, new_flag,
+                          mode_flag);
+      _vfi_log_argument(ctx, function, arg, is_input, FFLOAT_PTR, arg_id, j,
+                        before, fvalue->u32);
+    }
+    _vfi_scan_binary32(ctx, arg, &fvalue->f32, size - nb_logged, is_input,
+                       (!new_flag) && mode_flag);
+  }
+}
+
+static const _vfi_argument_handler_t _vfi_argument_handlers[FTYPES_END] = {
+    [FDOUBLE] = _vfi_handle_binary64,
+    [FFLOAT] = _vfi_handle_binary32,
+    [FDOUBLE_PTR] = _vfi_handle_binary64_ptr,
+    [FFLOAT_PTR] = _vfi_handle_binary32_ptr};
+
+/* return the handler of the arguments of the given type, NULL for the */
+/* types that are left as is */
+static _vfi_argument_handler_t _vfi_argument_handler(int type) {
+  if (type < 0 || type >= FTYPES_END)
+    return NULL;
+  return _vfi_argument_handlers[type];
+}
+
+/* process an argument with its handler. The arguments of calls that are */
+/* not traced are rounded the same way but their range is not updated */
+static inline void
+_vfi_process_argument(vprec_context_t *ctx, _vfi_t *function,
+                      _vfi_argument_data_t *arg, char is_input, int type,
+                      const char *arg_id, unsigned int size, void *value,
+                      int new_flag, int mode_flag, int traced) {
+  _vfi_argument_handler_t handler = arg->handler;
+  // an argument of the input profile recorded with another type
+  if (arg->data_type != type)
+    handler = _vfi_argument_handler(type);
+  if (handler == NULL)
+    return;
+
+  // the range of an untraced call, or of any call when the ranges are not
+  // tracked, goes to a copy of arg that is dropped
+  _vfi_argument_data_t untraced;
+  if (!traced || !ctx->vfi->track_ranges) {
+    untraced = *arg;
+    untraced.exponent_hist = NULL;
+    arg = &untraced;
+    new_flag = 0;
+  }
+
+  handler(ctx, function, arg, is_input, arg_id, size, value, new_flag,
+          mode_flag, traced);
+}
+
+/* allocate the metadata of nb_args arguments seen for the first time */
+static _vfi_argument_data_t *_vfi_alloc_arguments(vprec_context_t *ctx,
+                                                  int nb_args) {
+  return _vfi_arena_alloc(&ctx->vfi->arena,
+                          sizeof(_vfi_argument_data_t) * nb_args);
+}
+
+/* true if the arguments are not allocated yet, another thread may be */
+/* allocating them */
+static inline int _vfi_unbound(_vfi_argument_data_t *const *args,
+                               int nb_args) {
+  return nb_args > 0 && __atomic_load_n(args, __ATOMIC_ACQUIRE) == NULL;
+}
+
+/* allocate the nb_args arguments described by descs at the first call of */
+/* their function, stored in args and nb. Several threads may call the */
+/* function for the first time, return true for the one that allocated them */
+static int _vfi_bind_arguments(vprec_context_t *ctx,
+                               _vfi_argument_data_t **args, int *nb,
+                               int nb_args, const _vfi_arg_desc_t *descs) {
+  pthread_mutex_lock(&ctx->vfi->lock);
+  int bound = (*args == NULL);
+  if (bound) {
+    _vfi_argument_data_t *new_args = _vfi_alloc_arguments(ctx, nb_args);
+    for (int i = 0; i < nb_args; i++)
+      _vfi_init_argument(ctx, &new_args[i], descs[i].type, descs[i].id);
+    *nb = nb_args;
+    __atomic_store_n(args, new_args, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&ctx->vfi->lock);
+  return bound;
+}
+
+/* same as _vfi_bind_arguments with the (type, id, size, address) va_list */
+/* quadruplets, ap is left as is */
+static int _vfi_bind_va_arguments(vprec_context_t *ctx,
+                                  _vfi_argument_data_t **args, int *nb,
+                                  int nb_args, va_list ap) {
+  _vfi_arg_desc_t *descs = interflop_malloc(nb_args * sizeof(_vfi_arg_desc_t));
+  va_list quadruplets;
+  va_copy(quadruplets, ap);
+  for (int i = 0; i < nb_args; i++) {
+    descs[i].type = va_arg(quadruplets, int);
+    descs[i].id = va_arg(quadruplets, char *);
+    descs[i].size = va_arg(quadruplets, unsigned int);
+    (void)va_arg(quadruplets, void *);
+  }
+  va_end(quadruplets);
+  int bound = _vfi_bind_arguments(ctx, args, nb, nb_args, descs);
+  interflop_free(descs);
+  return bound;
+}
+
+/* true if the input arguments of function must be rounded, rounding to */
+/* the full precision and range is skipped unless denormals are affected */
+static inline int _vfi_round_inputs(vprec_context_t *ctx,
+                                    const _vfi_t *function) {
+  return (((ctx->mode == vprecmode_full) || (ctx->mode == vprecmode_ib)) &&
+          ((ctx->vfi->vprec_inst_mode == vprecinst_all) ||
+           (ctx->vfi->vprec_inst_mode == vprecinst_arg)) &&
+          ctx->vfi->vprec_inst_mode != vprecinst_none) &&
+         ((function->flags & VFI_REDUCED_INPUTS) || ctx->daz || ctx->absErr);
+}
+
+/* true if the output arguments of function must be rounded, rounding to */
+/* the full precision and range is skipped unless denormals are affected */
+static inline int _vfi_round_outputs(vprec_context_t *ctx,
+                                     const _vfi_t *function) {
+  return (((ctx->mode == vprecmode_full) || (ctx->mode == vprecmode_ob)) &&
+          (ctx->vfi->vprec_inst_mode == vprecinst_all ||
+           ctx->vfi->vprec_inst_mode == vprecinst_arg) &&
+          ctx->vfi->vprec_inst_mode != vprecinst_none) &&
+         ((function->flags & VFI_REDUCED_OUTPUTS) || ctx->ftz || ctx->absErr);
+}
+
+/* Sampling */
+
+/* state of the generator drawing the traced calls, per thread */
+static __thread uint64_t _vfi_sample_state = 0;
+
+/* xorshift64* */
+static inline uint64_t _vfi_sample_random(void) {
+  uint64_t x = _vfi_sample_state;
+  // seed each thread differently
+  if (x == 0)
+    x = _vfi_profile_hash("vfi") ^ (uintptr_t)&_vfi_sample_state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  _vfi_sample_state = x;
+  return x * 0x2545f4914f6cdd1dULL;
+}
+
+/* true if the current call of function is traced: the ranges of its */
+/* arguments are updated and it is logged. Untraced calls are still rounded */
+static inline int _vfi_sample(vprec_context_t *ctx, const _vfi_t *function) {
+  int period = ctx->vfi->sample_period;
+  int call = function->n_calls - ctx->vfi->sample_warmup;
+
+  if (period == 1 || call <= 0)
+    return 1;
+  if (ctx->vfi->sample_random)
+    return _vfi_sample_random() % period == 0;
+  // the first call after the warmup is traced
+  return (call - 1) % period == 0;
+}
+
+/* Log filters */
+
+/* true if the current traced call of function is logged. The filters of */
+/* --prec-log-* are checked here, before any log record is built, and the */
+/* match of the function id is computed once per log file. The count of */
+/* logged calls is shared by the threads, so that at most log_max_calls */
+/* calls of the function are logged in total */
+static inline int _vfi_log_call(vprec_context_t *ctx, _vfi_t *function) {
+  t_context_vfi *vfi = ctx->vfi;
+
+  if (_vprec_log_file == NULL ||
+      vfi->vprec_log_depth >= (ISize_t)vfi->log_max_depth)
+    return 0;
+  if (__atomic_load_n(&function->log_generation, __ATOMIC_ACQUIRE) !=
+      vfi->log_generation) {
+    pthread_mutex_lock(&vfi->lock);
+    if (function->log_generation != vfi->log_generation) {
+      function->log_match =
+          !vfi->log_functions_compiled ||
+          regexec(&vfi->log_functions_regex, function->id, 0, NULL, 0) == 0;
+      __atomic_store_n(&function->log_calls, 0, __ATOMIC_RELAXED);
+      __atomic_store_n(&function->log_generation, vfi->log_generation,
+                       __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&vfi->lock);
+  }
+  if (!function->log_match)
+    return 0;
+
+  // count the call only while the cap is not reached
+  int calls = __atomic_load_n(&function->log_calls, __ATOMIC_RELAXED);
+  do {
+    if (calls >= vfi->log_max_calls)
+      return 0;
+  } while (!__atomic_compare_exchange_n(&function->log_calls, &calls,
+                                        calls + 1, 1, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED));
+  return 1;
+}
+
+/* Enter and exit */
+
+/* resolve the entered function, set its internal operations precision and */
+/* log the entry. traced is set to VFI_TRACED if the call is sampled, with */
+/* VFI_LOGGED if it passes the log filters */
+static _vfi_t *_vfi_enter(interflop_function_stack_t *stack,
+                          vprec_context_t *ctx, int *traced) {
+  interflop_function_info_t *function_info = stack->array[stack->top];
+
+  if (function_info == NULL)
+    logger_error("Call stack error\n");
+
+  _vfi_checkpoint_count(ctx);
+
+  _vfi_t *function_inst = _vfi_resolve(ctx, function_info, true);
+
+  // increment the number of calls
+  function_inst->n_calls++;
+  *traced = 0;
+  if (_vfi_sample(ctx, function_inst)) {
+    *traced = VFI_TRACED;
+    if (_vfi_log_call(ctx, function_inst))
+      *traced |= VFI_LOGGED;
+  }
+
+  // save the configuration of the caller, restored on exit
+  _vfi_shadow_push(ctx, function_inst, *traced);
+
+  // set internal operations precision with custom values depending on the mode
+  if (!function_info->isLibraryFunction &&
+      !function_info->isIntrinsicFunction &&
+      ctx->vfi->vprec_inst_mode != vprecinst_arg &&
+      ctx->vfi->vprec_inst_mode != vprecinst_none) {
+    _vfi_set_ops_precision(ctx, function_inst);
+  }
+
+  // print function info in log
+  if (*traced & VFI_LOGGED) {
+    _vfi_log_blank(ctx);
+    _vfi_log_function(ctx, vfilog_enter, function_inst);
+  }
+
+  return function_inst;
+}
 
+/* resolve the exited function, restore the internal operations precision */
+/* of its parent and log the exit. traced is set as on entry */
+static _vfi_t *_vfi_exit(interflop_function_stack_t *stack,
+                         vprec_context_t *ctx, int *traced) {
   interflop_function_info_t *function_info = stack->array[stack->top];
 
   // decrement depth
@@ -679,8 +3280,13 @@ void _vfi_exit_function(interflop_function_stack_t *stack, void *context,
   if (function_info == NULL)
     logger_error("Call stack error \n");
 
-  _vfi_t *function_inst = vfc_hashmap_get(
-      ctx->vfi->map, vfc_hashmap_str_function(function_info->id));
+  _vfi_frame_t *frame = _vfi_shadow_pop();
+
+  _vfi_t *function_inst = (frame != NULL && frame->function != NULL)
+                              ? frame->function
+                              : _vfi_resolve(ctx, function_info, false);
+  // an exit without entry is traced but not logged
+  *traced = (frame != NULL) ? frame->traced : VFI_TRACED;
 
   // set internal operations precision with parent function values
   if (stack->array[stack->top + 1] != NULL) {
@@ -690,199 +3296,165 @@ void _vfi_exit_function(interflop_function_stack_t *stack, void *context,
         ctx->vfi->vprec_inst_mode != vprecinst_arg &&
         ctx->vfi->vprec_inst_mode != vprecinst_none) {
 
-      _vfi_t *function_parent = vfc_hashmap_get(
-          ctx->vfi->map, vfc_hashmap_str_function(parent_info->id));
-
-      if (function_parent != NULL) {
-        _set_vprec_precision_binary64(function_parent->OpsPrec64, ctx);
-        _set_vprec_range_binary64(function_parent->OpsRange64, ctx);
-        _set_vprec_precision_binary32(function_parent->OpsPrec32, ctx);
-        _set_vprec_range_binary32(function_parent->OpsRange32, ctx);
+      if (frame != NULL) {
+        // the configuration saved on enter is the one set by the parent
+        ctx->binary64_precision = frame->binary64_precision;
+        ctx->binary64_range = frame->binary64_range;
+        ctx->binary32_precision = frame->binary32_precision;
+        ctx->binary32_range = frame->binary32_range;
+      } else {
+        _vfi_t *function_parent = _vfi_resolve(ctx, parent_info, false);
+
+        if (function_parent != NULL)
+          _vfi_set_ops_precision(ctx, function_parent);
       }
     }
   }
 
-  // treatment of arguments
-  int new_flag = (function_inst->output_args == NULL && nb_args > 0);
-
   // print function info in log
-  _vfi_print_log(ctx, "exit of %s\t%d\t%d\t%d\t%d\n", function_inst->id,
-                 function_inst->OpsPrec64, function_inst->OpsRange64,
-                 function_inst->OpsPrec32, function_inst->OpsRange32);
+  if (*traced & VFI_LOGGED)
+    _vfi_log_function(ctx, vfilog_exit, function_inst);
+
+  return function_inst;
+}
+
+// vprec function instrumentation
+// Set precision for internal operations and round input arguments for a given
+// function call
+void _vfi_enter_function(interflop_function_stack_t *stack, void *context,
+                         int nb_args, va_list ap) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  int traced;
+  _vfi_t *function_inst = _vfi_enter(stack, ctx, &traced);
+
+  // treatment of arguments, allocated at the first call
+  int new_flag = _vfi_unbound(&function_inst->input_args, nb_args) &&
+                 _vfi_bind_va_arguments(ctx, &function_inst->input_args,
+                                        &function_inst->nb_input_args,
+                                        nb_args, ap);
 
-  // allocate memory for arguments
-  if (new_flag) {
-    function_inst->output_args =
-        interflop_malloc(sizeof(_vfi_argument_data_t) * nb_args);
-    function_inst->nb_output_args = nb_args;
+  // boolean which indicates if arguments should be rounded or not depending on
+  // modes
+  int mode_flag = _vfi_round_inputs(ctx, function_inst);
+
+  // nothing to round, to save or to log
+  if (!new_flag && !mode_flag && !(traced && ctx->vfi->trace_args))
+    nb_args = 0;
+
+  for (int i = 0; i < nb_args; i++) {
+    // get argument type, id and size
+    int type = va_arg(ap, int);
+    char *arg_id = va_arg(ap, char *);
+    unsigned int size = va_arg(ap, unsigned int);
+    void *value = va_arg(ap, void *);
+
+    _vfi_process_argument(ctx, function_inst, &function_inst->input_args[i], 1,
+                          type, arg_id, size, value, new_flag, mode_flag,
+                          traced);
   }
 
+  // increment depth
+  ctx->vfi->vprec_log_depth++;
+}
+
+// vprec function instrumentation
+// Set precision for internal operations and round output arguments for a given
+// function call
+void _vfi_exit_function(interflop_function_stack_t *stack, void *context,
+                        int nb_args, va_list ap) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  int traced;
+  _vfi_t *function_inst = _vfi_exit(stack, ctx, &traced);
+
+  // treatment of arguments, allocated at the first call
+  int new_flag = _vfi_unbound(&function_inst->output_args, nb_args) &&
+                 _vfi_bind_va_arguments(ctx, &function_inst->output_args,
+                                        &function_inst->nb_output_args,
+                                        nb_args, ap);
+
   // boolean which indicates if arguments should be rounded or not depending on
   // modes
-  int mode_flag =
-      (((ctx->mode == vprecmode_full) || (ctx->mode == vprecmode_ob)) &&
-       (ctx->vfi->vprec_inst_mode == vprecinst_all ||
-        ctx->vfi->vprec_inst_mode == vprecinst_arg) &&
-       ctx->vfi->vprec_inst_mode != vprecinst_none);
+  int mode_flag = _vfi_round_outputs(ctx, function_inst);
+
+  // nothing to round, to save or to log
+  if (!new_flag && !mode_flag && !(traced && ctx->vfi->trace_args))
+    nb_args = 0;
 
   for (int i = 0; i < nb_args; i++) {
     int type = va_arg(ap, int);
     char *arg_id = va_arg(ap, char *);
     unsigned int size = va_arg(ap, unsigned int);
+    void *value = va_arg(ap, void *);
 
-    if (new_flag) {
-      // initialize arguments data
-      function_inst->output_args[i].data_type = type;
-      interflop_strcpy(function_inst->output_args[i].arg_id, arg_id);
-      function_inst->output_args[i].exponent_length =
-          (type == FDOUBLE || type == FDOUBLE_PTR)
-              ? VPREC_RANGE_BINARY64_DEFAULT
-              : VPREC_RANGE_BINARY32_DEFAULT;
-      function_inst->output_args[i].mantissa_length =
-          (type == FDOUBLE || type == FDOUBLE_PTR)
-              ? VPREC_PRECISION_BINARY64_DEFAULT
-              : VPREC_PRECISION_BINARY32_DEFAULT;
-      function_inst->output_args[i].min_range = INT_MAX;
-      function_inst->output_args[i].max_range = INT_MIN;
-    }
-
-    if (type == FDOUBLE) {
-      double *value = va_arg(ap, double *);
-
-      _vfi_print_log(ctx, " - %s\toutput\tdouble\t%s\t%la\t->\t",
-                     function_inst->id, arg_id, *value);
-
-      if ((!new_flag) && mode_flag) {
-        *value = _vprec_round_binary64(
-            *value, 0, context, function_inst->output_args[i].exponent_length,
-            function_inst->output_args[i].mantissa_length);
-      }
+    _vfi_process_argument(ctx, function_inst, &function_inst->output_args[i], 0,
+                          type, arg_id, size, value, new_flag, mode_flag,
+                          traced);
+  }
 
-      if (!(interflop_isnan(*value) || interflop_isinf(*value))) {
-        function_inst->output_args[i].min_range =
-            (interflop_floor(*value) <
-                 function_inst->output_args[i].min_range ||
-             new_flag)
-                ? interflop_floor(*value)
-                : function_inst->output_args[i].min_range;
-        function_inst->output_args[i].max_range =
-            (interflop_ceil(*value) > function_inst->output_args[i].max_range ||
-             new_flag)
-                ? interflop_ceil(*value)
-                : function_inst->output_args[i].max_range;
-      }
+  if (traced & VFI_LOGGED)
+    _vfi_log_blank(ctx);
+}
 
-      _vfi_print_log(ctx, "%la\t(%d,%d)\n", *value,
-                     function_inst->output_args[i].mantissa_length,
-                     function_inst->output_args[i].exponent_length);
-    } else if (type == FFLOAT) {
-      float *value = va_arg(ap, float *);
+// vprec function instrumentation with argument descriptors
+// Same as _vfi_enter_function, the arguments are described by a static array
+// of descriptors and their addresses are given by values
+void _vfi_enter_function_desc(interflop_function_stack_t *stack,
+                              void *context, int nb_args,
+                              const _vfi_arg_desc_t *descs, void **values) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  int traced;
+  _vfi_t *function_inst = _vfi_enter(stack, ctx, &traced);
 
-      _vfi_print_log(ctx, " - %s\toutput\tfloat\t%s\t%a\t->\t",
-                     function_inst->id, arg_id, *value);
+  // bind the descriptors to the argument slots once
+  int new_flag = _vfi_unbound(&function_inst->input_args, nb_args) &&
+                 _vfi_bind_arguments(ctx, &function_inst->input_args,
+                                     &function_inst->nb_input_args, nb_args,
+                                     descs);
 
-      if ((!new_flag) && mode_flag) {
-        *value = _vprec_round_binary32(
-            *value, 0, context, function_inst->output_args[i].exponent_length,
-            function_inst->output_args[i].mantissa_length);
-      }
+  int mode_flag = _vfi_round_inputs(ctx, function_inst);
 
-      if (!(interflop_isnan(*value) || interflop_isinf(*value))) {
-        function_inst->output_args[i].min_range =
-            (interflop_floor(*value) <
-                 function_inst->output_args[i].min_range ||
-             new_flag)
-                ? interflop_floor(*value)
-                : function_inst->output_args[i].min_range;
-        function_inst->output_args[i].max_range =
-            (interflop_ceil(*value) > function_inst->output_args[i].max_range ||
-             new_flag)
-                ? interflop_ceil(*value)
-                : function_inst->output_args[i].max_range;
-      }
+  // nothing to round, to save or to log
+  if (!new_flag && !mode_flag && !(traced && ctx->vfi->trace_args))
+    nb_args = 0;
 
-      _vfi_print_log(ctx, "%a\t(%d, %d)\n", *value,
-                     function_inst->output_args[i].mantissa_length,
-                     function_inst->output_args[i].exponent_length);
-    } else if (type == FDOUBLE_PTR) {
-      double *value = va_arg(ap, double *);
-
-      for (unsigned int j = 0; j < size; j++, value++) {
-        if (value == NULL) {
-          _vfi_print_log(ctx,
-                         " - %s\toutput[%u]\tdouble_ptr\t%s\tNULL\t->\tNULL\n",
-                         function_inst->id, j, arg_id);
-          continue;
-        }
-
-        _vfi_print_log(ctx, " - %s\toutput[%u]\tdouble_ptr\t%s\t%la\t->\t",
-                       function_inst->id, j, arg_id, *value);
-
-        if ((!new_flag) && mode_flag) {
-          *value = _vprec_round_binary64(
-              *value, 0, context, function_inst->output_args[i].exponent_length,
-              function_inst->output_args[i].mantissa_length);
-        }
-
-        if (!(interflop_isnan(*value) || interflop_isinf(*value))) {
-          function_inst->output_args[i].min_range =
-              (interflop_floor(*value) <
-                   function_inst->output_args[i].min_range ||
-               new_flag)
-                  ? interflop_floor(*value)
-                  : function_inst->output_args[i].min_range;
-          function_inst->output_args[i].max_range =
-              (interflop_ceil(*value) >
-                   function_inst->output_args[i].max_range ||
-               new_flag)
-                  ? interflop_ceil(*value)
-                  : function_inst->output_args[i].max_range;
-        }
-
-        _vfi_print_log(ctx, "%la\t(%d,%d)\n", *value,
-                       function_inst->output_args[i].mantissa_length,
-                       function_inst->output_args[i].exponent_length);
-      }
-    } else if (type == FFLOAT_PTR) {
-      float *value = va_arg(ap, float *);
-
-      for (unsigned int j = 0; j < size; j++, value++) {
-        if (value == NULL) {
-          _vfi_print_log(ctx,
-                         " - %s\toutput[%u]\tfloat_ptr\t%s\tNULL\t->\tNULL\n",
-                         function_inst->id, j, arg_id);
-          continue;
-        }
-
-        _vfi_print_log(ctx, " - %s\toutput[%u]\tfloat_ptr\t%s\t%a\t->\t",
-                       function_inst->id, j, arg_id, *value);
-
-        if ((!new_flag) && mode_flag) {
-          *value = _vprec_round_binary32(
-              *value, 0, context, function_inst->output_args[i].exponent_length,
-              function_inst->output_args[i].mantissa_length);
-        }
-
-        if (!(interflop_isnan(*value) || interflop_isinf(*value))) {
-          function_inst->output_args[i].min_range =
-              (interflop_floor(*value) <
-                   function_inst->output_args[i].min_range ||
-               new_flag)
-                  ? interflop_floor(*value)
-                  : function_inst->output_args[i].min_range;
-          function_inst->output_args[i].max_range =
-              (interflop_ceil(*value) >
-                   function_inst->output_args[i].max_range ||
-               new_flag)
-                  ? interflop_ceil(*value)
-                  : function_inst->output_args[i].max_range;
-        }
-
-        _vfi_print_log(ctx, "%a\t(%d, %d)\n", *value,
-                       function_inst->output_args[i].mantissa_length,
-                       function_inst->output_args[i].exponent_length);
-      }
-    }
+  for (int i = 0; i < nb_args; i++) {
+    _vfi_process_argument(ctx, function_inst, &function_inst->input_args[i], 1,
+                          descs[i].type, descs[i].id, descs[i].size, values[i],
+                          new_flag, mode_flag, traced);
+  }
+
+  // increment depth
+  ctx->vfi->vprec_log_depth++;
+}
+
+// vprec function instrumentation with argument descriptors
+// Same as _vfi_exit_function, the arguments are described by a static array
+// of descriptors and their addresses are given by values
+void _vfi_exit_function_desc(interflop_function_stack_t *stack, void *context,
+                             int nb_args, const _vfi_arg_desc_t *descs,
+                             void **values) {
+  vprec_context_t *ctx = (vprec_context_t *)context;
+  int traced;
+  _vfi_t *function_inst = _vfi_exit(stack, ctx, &traced);
+
+  // bind the descriptors to the argument slots once
+  int new_flag = _vfi_unbound(&function_inst->output_args, nb_args) &&
+                 _vfi_bind_arguments(ctx, &function_inst->output_args,
+                                     &function_inst->nb_output_args, nb_args,
+                                     descs);
+
+  int mode_flag = _vfi_round_outputs(ctx, function_inst);
+
+  // nothing to round, to save or to log
+  if (!new_flag && !mode_flag && !(traced && ctx->vfi->trace_args))
+    nb_args = 0;
+
+  for (int i = 0; i < nb_args; i++) {
+    _vfi_process_argument(ctx, function_inst, &function_inst->output_args[i], 0,
+                          descs[i].type, descs[i].id, descs[i].size, values[i],
+                          new_flag, mode_flag, traced);
   }
-  _vfi_print_log(ctx, "\n");
-}
\ No newline at end of file
+
+  if (traced & VFI_LOGGED)
+    _vfi_log_blank(ctx);
+}
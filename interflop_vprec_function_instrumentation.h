@@ -21,9 +21,16 @@
 #ifndef __INTERFLOP_VPREC_FUNCTION_INSTRUMENTATION_H__
 #define __INTERFLOP_VPREC_FUNCTION_INSTRUMENTATION_H__
 
+#include <pthread.h>
+#include <regex.h>
+#include <sys/types.h>
+
 #include "interflop-stdlib/hashmap/vfc_hashmap.h"
 #include "interflop-stdlib/interflop.h"
 #include "interflop-stdlib/interflop_stdlib.h"
+#include "interflop_vprec_log.h"
+#include "interflop_vprec_pool.h"
+#include "interflop_vprec_profile.h"
 
 /* define instrumentation modes */
 typedef enum {
@@ -34,12 +41,28 @@ typedef enum {
   _vprecinst_end_
 } vprec_inst_mode;
 
+/* largest bit length of the unbiased exponent of a binary64 value */
+#define VFI_HIST_EXP_BITS 11
+/* number of bins of the exponent histograms: bin 0 counts the zeros and */
+/* bin VFI_HIST_EXP_BITS + 1 + b the values whose unbiased exponent has */
+/* |b| bits and the sign of b, for b in [-VFI_HIST_EXP_BITS, */
+/* VFI_HIST_EXP_BITS] */
+#define VFI_HIST_BINS (2 * VFI_HIST_EXP_BITS + 2)
+/* bin of the zeros */
+#define VFI_HIST_ZERO 0
+
+struct _vprec_argument_data;
+struct _vprec_function_instrumentation;
+
+// Rounds an argument of a call, records its range and logs it, chosen from
+// the type of the argument, see _vfi_argument_handler
+typedef void (*_vfi_argument_handler_t)(
+    void *context, struct _vprec_function_instrumentation *function,
+    struct _vprec_argument_data *arg, char is_input, const char *arg_id,
+    unsigned int size, void *value, int new_flag, int mode_flag, int traced);
+
 // Metadata of arguments
 typedef struct _vprec_argument_data {
-  // Identifier of the argument
-  char arg_id[100];
-  // Data type of the argument 0 is float and 1 is double
-  short data_type;
   // Minimum rounded value of the argument
   int min_range;
   // Maximum rounded value of the argument
@@ -48,58 +71,259 @@ typedef struct _vprec_argument_data {
   int exponent_length;
   // Mantissa length of the argument
   int mantissa_length;
+  // Data type of the argument 0 is float and 1 is double
+  short data_type;
+  // Handler of the values of the argument, set from data_type
+  _vfi_argument_handler_t handler;
+  // Identifier of the argument, interned in the string pool
+  const char *arg_id;
+  // Number of finite values of the argument in each exponent bin, stored
+  // apart from the fields read on every call, NULL if no output profile is
+  // written
+  ISize_t *exponent_hist;
 } _vfi_argument_data_t;
 
-// Metadata of function calls
+// Metadata of function calls, the fields used on every call come first
 typedef struct _vprec_function_instrumentation {
-  // Id of the function
-  char id[500];
-  // Indicate if the function is from library
-  short isLibraryFunction;
-  // Indicate if the function is intrinsic
-  short isIntrinsicFunction;
-  // Counter of Floating Point instruction
-  ISize_t useFloat;
-  // Counter of Floating Point instruction
-  ISize_t useDouble;
-  // Internal Operations Range64
-  int OpsRange64;
   // Internal Operations Prec64
   int OpsPrec64;
-  // Internal Operations Range32
-  int OpsRange32;
+  // Internal Operations Range64
+  int OpsRange64;
   // Internal Operations Prec32
   int OpsPrec32;
+  // Internal Operations Range32
+  int OpsRange32;
+  // Number of call for this call site
+  int n_calls;
+  // Arguments whose rounding is not the identity, see VFI_REDUCED_*
+  int flags;
   // Number of floating point input arguments
   int nb_input_args;
-  // Array of data on input arguments
-  _vfi_argument_data_t *input_args;
   // Number of floating point output arguments
   int nb_output_args;
+  // Array of data on input arguments
+  _vfi_argument_data_t *input_args;
   // Array of data on output arguments
   _vfi_argument_data_t *output_args;
-  // Number of call for this call site
-  int n_calls;
+  // Id of the function, interned in the string pool
+  const char *id;
+  // Indicate if the function is from library
+  short isLibraryFunction;
+  // Indicate if the function is intrinsic
+  short isIntrinsicFunction;
+  // Counter of Floating Point instruction
+  ISize_t useFloat;
+  // Counter of Floating Point instruction
+  ISize_t useDouble;
+  // Log generation for which log_match and log_calls were computed, set
+  // under the context lock and read atomically
+  int log_generation;
+  // True if the id matches --prec-log-functions
+  int log_match;
+  // Number of calls logged since the log file was opened, updated atomically
+  int log_calls;
 } _vfi_t;
 
+/* some input arguments have a reduced precision or range */
+#define VFI_REDUCED_INPUTS 0x1
+/* some output arguments have a reduced precision or range */
+#define VFI_REDUCED_OUTPUTS 0x2
+
+/* the argument ranges of the call are updated, see --instrument-sample */
+#define VFI_TRACED 0x1
+/* the call is logged, see --prec-log-functions and --prec-log-max-* */
+#define VFI_LOGGED 0x2
+
+/* size of the name of a shared profile segment, see --prec-input-shared */
+#define VFI_SHARED_NAME_SIZE 64
+
+// Chunk of an arena
+typedef struct _vfi_arena_chunk {
+  struct _vfi_arena_chunk *next;
+  size_t size;
+  size_t used;
+  char data[];
+} _vfi_arena_chunk_t;
+
+// Bump allocator whose allocations are all released at once
+typedef struct {
+  _vfi_arena_chunk_t *chunks;
+} _vfi_arena_t;
+
+// Pool storing each function id and argument name once
+typedef struct {
+  _vfi_arena_t arena;
+  // Open addressing set of the interned strings
+  const char **strings;
+  // Number of entries of the set, always a power of two
+  size_t capacity;
+  size_t nb_strings;
+} _vfi_string_pool_t;
+
+// Resolved function of a call site
+typedef struct {
+  // Address of the call site information, NULL if the entry is empty
+  const interflop_function_info_t *site;
+  // Id of the call site when it was resolved
+  const char *id;
+  // Resolved function
+  _vfi_t *function;
+} _vfi_site_t;
+
+// Per-thread open addressing table of resolved functions keyed by call site
+typedef struct {
+  _vfi_site_t *sites;
+  // Number of entries, always a power of two
+  size_t capacity;
+  size_t nb_items;
+  // Value of site_generation of the context when the table was filled
+  int generation;
+} _vfi_site_cache_t;
+
+// Frame of the VFI shadow stack, pushed when entering a function
+typedef struct {
+  // Resolved function, NULL if it was freed by a profile reload
+  _vfi_t *function;
+  // Internal operations precision and range of the caller
+  int binary64_precision;
+  int binary64_range;
+  int binary32_precision;
+  int binary32_range;
+  // VFI_TRACED and VFI_LOGGED if the call is traced and logged
+  int traced;
+} _vfi_frame_t;
+
+// Per-thread stack of the instrumented functions being executed
+typedef struct {
+  _vfi_frame_t *frames;
+  size_t capacity;
+  size_t top;
+} _vfi_shadow_stack_t;
+
+// Static description of a floating point argument of a call site, the
+// alternative to the (type, id, size, address) va_list quadruplets
+typedef struct {
+  // Type of the argument (enum FTYPES)
+  int type;
+  // Identifier of the argument
+  const char *id;
+  // Number of elements for pointer types
+  unsigned int size;
+} _vfi_arg_desc_t;
+
 /* default instrumentation mode */
 #define VPREC_INST_MODE_DEFAULT vprecinst_none
 
+/* default number of threads processing large pointer arguments */
+#define VPREC_INST_THREADS_DEFAULT 1
+
+/* default number of elements above which pointer arguments are split */
+#define VPREC_INST_THRESHOLD_DEFAULT (1 << 20)
+
+/* by default every call is traced */
+#define VPREC_INST_SAMPLE_DEFAULT 1
+
+/* by default the log depth, calls and elements are not limited */
+#define VPREC_LOG_NO_LIMIT INT_MAX
+
 typedef struct {
   /* instrumentation variables */
   vfc_hashmap_t map;
+  /* minimal perfect hash over the function ids of the input profile */
+  _vfi_mph_t index;
+  /* functions of the input profile, ordered by slot of the perfect hash */
+  _vfi_t **profile_slots;
+  /* compiled profile loaded from the input file, if any */
+  const _vfi_profile_t *profile;
+  /* dlopen handle of the compiled profile */
+  void *profile_handle;
+  /* binary profile mapped in memory and its size, profile points to */
+  /* profile_tables */
+  void *profile_map;
+  size_t profile_map_size;
+  _vfi_profile_t profile_tables;
+  /* shared memory segment holding profile_map, see --prec-input-shared, */
+  /* its header page, the process counted as one of its users and its */
+  /* inode, checked before unlinking the name */
+  char profile_shm_name[VFI_SHARED_NAME_SIZE];
+  void *profile_shm_header;
+  pid_t profile_shm_owner;
+  dev_t profile_shm_dev;
+  ino_t profile_shm_ino;
+  /* incremented when the functions are freed, the call site caches of the */
+  /* threads are cleared when they see it change */
+  int site_generation;
+  /* serializes the lookups missing the call site caches, the creation of */
+  /* the functions and of their arguments, the insertions in map and the */
+  /* allocations in strings and arena */
+  pthread_mutex_t lock;
+  /* function ids and argument names */
+  _vfi_string_pool_t strings;
+  /* functions and their arguments, released when the profile is unloaded */
+  _vfi_arena_t arena;
   const char *vprec_input_file;
   const char *vprec_output_file;
   const char *vprec_log_file;
+  _vfi_log_format_t vprec_log_format;
   vprec_inst_mode vprec_inst_mode;
   ISize_t vprec_log_depth;
+  /* true if the argument ranges are saved or the arguments are logged */
+  IBool trace_args;
+  /* number of threads processing large pointer arguments and profiles */
+  int nb_threads;
+  /* number of elements above which pointer arguments are split */
+  ISize_t parallel_threshold;
+  /* workers processing large pointer arguments and text profiles, NULL */
+  /* if nb_threads is 1 */
+  _vprec_pool_t *pool;
+  /* one call out of sample_period of each function is traced */
+  int sample_period;
+  /* number of calls of each function traced before sampling */
+  int sample_warmup;
+  /* true if the traced calls are drawn at random */
+  IBool sample_random;
+  /* false if the argument ranges are left to vfi_log_replay.py */
+  IBool track_ranges;
+  /* regular expression of the logged function ids, NULL to log them all */
+  const char *vprec_log_functions;
+  /* vprec_log_functions compiled when the log is opened */
+  regex_t log_functions_regex;
+  IBool log_functions_compiled;
+  /* incremented each time the log is opened, see _vfi_t */
+  int log_generation;
+  /* calls nested in log_max_depth instrumented calls are not logged */
+  int log_max_depth;
+  /* number of calls logged per function */
+  int log_max_calls;
+  /* number of elements logged per pointer argument */
+  int log_max_elements;
+  /* seconds between checkpoints of the output profile, 0 for none */
+  int checkpoint_interval;
+  /* instrumented calls of the process between checkpoints, 0 for none */
+  int checkpoint_calls;
+  /* true if SIGUSR1 triggers a checkpoint */
+  IBool checkpoint_signal;
+  /* true if text input profiles are shared by the processes of the node */
+  IBool input_shared;
 } t_context_vfi;
 
 /* Setter functions for contextual variables */
 void _set_vprec_input_file(const char *input_file, void *context);
+void _set_vprec_input_shared(IBool shared, void *context);
 void _set_vprec_output_file(const char *output_file, void *context);
 void _set_vprec_log_file(const char *log_file, void *context);
+void _set_vprec_log_format(_vfi_log_format_t format, void *context);
 void _set_vprec_inst_mode(vprec_inst_mode mode, void *context);
+void _set_vprec_inst_threads(int nb_threads, void *context);
+void _set_vprec_inst_threshold(ISize_t threshold, void *context);
+void _set_vprec_inst_sample(int period, int warmup, IBool random,
+                            void *context);
+void _set_vprec_inst_ranges(IBool track_ranges, void *context);
+void _set_vprec_log_functions(const char *functions, void *context);
+void _set_vprec_log_limits(int max_depth, int max_calls, int max_elements,
+                           void *context);
+void _set_vprec_checkpoint(int interval, int calls, IBool signal,
+                           void *context);
 void _vfi_print_information_header(void *context);
 
 /* Vprec Function Instrumentation initializer */
@@ -111,6 +335,13 @@ void _vfi_init_context(void *context);
 /* Vprec Function Instrumentation context initializer */
 void _vfi_alloc_context(void *context);
 
+/* Vprec Function Instrumentation reloader, used when the files changed */
+void _vfi_reload(void *context, IBool reload_profile, IBool reopen_log);
+
+/* Vprec Function Instrumentation log flush, waits until the records */
+/* logged so far are written to the log file */
+void _vfi_flush_log(void *context);
+
 /* Vprec Function Instrumentation finalizer */
 void _vfi_finalize(void *context);
 
@@ -122,4 +353,14 @@ void _vfi_enter_function(interflop_function_stack_t *stack, void *context,
 void _vfi_exit_function(interflop_function_stack_t *stack, void *context,
                         int nb_args, va_list ap);
 
-#endif /* __INTERFLOP_VPREC_FUNCTION_INSTRUMENTATION_H__ */
\ No newline at end of file
+/* Vprec Function Instrumentation enter function with argument descriptors */
+void _vfi_enter_function_desc(interflop_function_stack_t *stack,
+                              void *context, int nb_args,
+                              const _vfi_arg_desc_t *descs, void **values);
+
+/* Vprec Function Instrumentation exit function with argument descriptors */
+void _vfi_exit_function_desc(interflop_function_stack_t *stack, void *context,
+                             int nb_args, const _vfi_arg_desc_t *descs,
+                             void **values);
+
+#endif /* __INTERFLOP_VPREC_FUNCTION_INSTRUMENTATION_H__ */
@@ -0,0 +1,537 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include "interflop-stdlib/common/float_struct.h"
+#include "interflop-stdlib/interflop.h"
+#include "interflop-stdlib/interflop_stdlib.h"
+#include "interflop-stdlib/iostream/logger.h"
+#include "interflop_vprec_log.h"
+#include "interflop_vprec_os.h"
+
+/******************** VPREC FUNCTION INSTRUMENTATION LOG *****************
+ * Each application thread appends raw records to its own single-producer
+ * single-consumer ring. A writer thread drains the rings and formats the
+ * records, so that the application threads never call printf. The order
+ * of the records of a thread is kept. The records are written as text
+ * lines or encoded in the binary format described in interflop_vprec_log.h.
+ *************************************************************************/
+
+/* number of records of the ring of each thread, must be a power of two */
+#define VFI_LOG_RING_SIZE 4096
+/* number of records formatted before releasing them to the producer */
+#define VFI_LOG_BATCH 64
+/* sleep of the writer when all the rings are empty, in nanoseconds */
+#define VFI_LOG_IDLE_NS 100000
+/* size of a cache line, separating the indices of the producer and consumer */
+#define VFI_LOG_CACHE_LINE 64
+/* size of the buffer of the binary encoder */
+#define VFI_LOG_BUFFER_SIZE (64 * 1024)
+/* largest encoding of a record, strings excluded */
+#define VFI_LOG_RECORD_MAX 64
+/* initial number of entries of the table of string ids */
+#define VFI_LOG_STRINGS_INIT_CAPACITY 256
+
+typedef struct _vfi_log_ring {
+  // next record written by the thread owning the ring
+  size_t head;
+  char pad_head[VFI_LOG_CACHE_LINE - sizeof(size_t)];
+  // next record formatted by the writer
+  size_t tail;
+  char pad_tail[VFI_LOG_CACHE_LINE - sizeof(size_t)];
+  // next ring, immutable once the ring is published
+  struct _vfi_log_ring *next;
+  _vfi_log_record_t records[VFI_LOG_RING_SIZE];
+} _vfi_log_ring_t;
+
+// String of the binary log and its id
+typedef struct {
+  const char *string;
+  uint64_t id;
+} _vfi_log_string_t;
+
+static struct {
+  File *file;
+  _vfi_log_format_t format;
+  pthread_t thread;
+  // pid of the process running the writer thread
+  pid_t owner;
+  // true if the writer thread is running
+  IBool running;
+  // true once _vfi_log_fork_child is registered
+  IBool atfork_registered;
+  // set to stop the writer once the rings are empty
+  int stop;
+  // set once the log is closed, the records pushed after are dropped
+  int closed;
+  // rings of all the threads, new rings are pushed in front
+  _vfi_log_ring_t *rings;
+  // serializes the writes when there is no writer thread
+  pthread_mutex_t lock;
+  // binary encoder: bytes not yet written to the file
+  uint8_t *buffer;
+  size_t buffer_size;
+  // binary encoder: ids of the strings already defined, keyed by address
+  _vfi_log_string_t *strings;
+  size_t strings_capacity;
+  size_t nb_strings;
+  // binary encoder: depth of the previous record
+  uint32_t depth;
+  // binary encoder: offset in the file of the next byte and of the last sync
+  uint64_t offset;
+  uint64_t sync_offset;
+} _vfi_log = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/* ring of the calling thread, NULL until its first record */
+static __thread _vfi_log_ring_t *_vfi_log_ring = NULL;
+
+/* Formatting */
+
+static const char _vfi_log_tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+/* indent a line by depth tabulations */
+static void _vfi_log_indent(File *file, uint32_t depth) {
+  const int nb_tabs = sizeof(_vfi_log_tabs) - 1;
+  while (depth > 0) {
+    int n = (depth < (uint32_t)nb_tabs) ? (int)depth : nb_tabs;
+    interflop_fprintf(file, "%.*s", n, _vfi_log_tabs);
+    depth -= n;
+  }
+}
+
+static inline double _vfi_log_binary64(uint64_t bits) {
+  binary64 x = {.u64 = bits};
+  return x.f64;
+}
+
+static inline float _vfi_log_binary32(uint64_t bits) {
+  binary32 x = {.u32 = (uint32_t)bits};
+  return x.f32;
+}
+
+/* write an argument record, the value before rounding and the value after */
+/* rounding are indented like two lines */
+static void _vfi_log_write_argument(File *file,
+                                    const _vfi_log_record_t *record) {
+  const char *kind = record->is_input ? "input" : "output";
+  const char *function = record->function;
+  const char *arg_id = record->arg_id;
+  IBool binary64 = record->type == FDOUBLE || record->type == FDOUBLE_PTR;
+
+  _vfi_log_indent(file, record->depth);
+  switch (record->type) {
+  case FDOUBLE:
+    interflop_fprintf(file, " - %s\t%s\tdouble\t%s\t%la\t->\t", function, kind,
+                      arg_id, _vfi_log_binary64(record->before));
+    break;
+  case FFLOAT:
+    interflop_fprintf(file, " - %s\t%s\tfloat\t%s\t%a\t->\t", function, kind,
+                      arg_id, _vfi_log_binary32(record->before));
+    break;
+  case FDOUBLE_PTR:
+    if (record->is_null) {
+      interflop_fprintf(file, " - %s\t%s[%u]\tdouble_ptr\t%s\tNULL\t->\tNULL\n",
+                        function, kind, record->index, arg_id);
+      return;
+    }
+    interflop_fprintf(file, " - %s\t%s[%u]\tdouble_ptr\t%s\t%la\t->\t",
+                      function, kind, record->index, arg_id,
+                      _vfi_log_binary64(record->before));
+    break;
+  case FFLOAT_PTR:
+    if (record->is_null) {
+      interflop_fprintf(file, " - %s\t%s[%u]\tfloat_ptr\t%s\tNULL\t->\tNULL\n",
+                        function, kind, record->index, arg_id);
+      return;
+    }
+    interflop_fprintf(file, " - %s\t%s[%u]\tfloat_ptr\t%s\t%a\t->\t", function,
+                      kind, record->index, arg_id,
+                      _vfi_log_binary32(record->before));
+    break;
+  default:
+    return;
+  }
+
+  _vfi_log_indent(file, record->depth);
+  if (binary64) {
+    // binary64 outputs have always been logged without the space
+    interflop_fprintf(file,
+                      record->is_input ? "%la\t(%d, %d)\n" : "%la\t(%d,%d)\n",
+                      _vfi_log_binary64(record->after), record->lengths[0],
+                      record->lengths[1]);
+  } else {
+    interflop_fprintf(file, "%a\t(%d, %d)\n", _vfi_log_binary32(record->after),
+                      record->lengths[0], record->lengths[1]);
+  }
+}
+
+/* format a record as the lines of the text log */
+static void _vfi_log_write_text(File *file, const _vfi_log_record_t *record) {
+  switch (record->kind) {
+  case vfilog_blank:
+    _vfi_log_indent(file, record->depth);
+    interflop_fprintf(file, "\n");
+    break;
+  case vfilog_enter:
+  case vfilog_exit:
+    _vfi_log_indent(file, record->depth);
+    interflop_fprintf(file, "%s %s\t%d\t%d\t%d\t%d\n",
+                      (record->kind == vfilog_enter) ? "enter in" : "exit of",
+                      record->function, record->lengths[0], record->lengths[1],
+                      record->lengths[2], record->lengths[3]);
+    break;
+  case vfilog_argument:
+    _vfi_log_write_argument(file, record);
+    break;
+  default:
+    break;
+  }
+}
+
+/* Binary encoding */
+
+/* write the buffered bytes to the file */
+static void _vfi_log_flush_buffer(void) {
+  if (_vfi_log.buffer_size > 0) {
+    interflop_fwrite(_vfi_log.buffer, 1, _vfi_log.buffer_size, _vfi_log.file);
+    _vfi_log.buffer_size = 0;
+  }
+}
+
+static void _vfi_log_put(const void *bytes, size_t size) {
+  _vfi_log.offset += size;
+  if (_vfi_log.buffer_size + size > VFI_LOG_BUFFER_SIZE)
+    _vfi_log_flush_buffer();
+  if (size > VFI_LOG_BUFFER_SIZE) {
+    interflop_fwrite(bytes, 1, size, _vfi_log.file);
+    return;
+  }
+  memcpy(_vfi_log.buffer + _vfi_log.buffer_size, bytes, size);
+  _vfi_log.buffer_size += size;
+}
+
+/* append an unsigned LEB128 varint to bytes, return the new end */
+static inline uint8_t *_vfi_log_varint(uint8_t *bytes, uint64_t value) {
+  while (value >= 0x80) {
+    *bytes++ = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  *bytes++ = (uint8_t)value;
+  return bytes;
+}
+
+/* append the zigzag varint of a signed value to bytes */
+static inline uint8_t *_vfi_log_svarint(uint8_t *bytes, int64_t value) {
+  return _vfi_log_varint(bytes,
+                         ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+/* append the nb_bytes low bytes of bits to bytes, little-endian */
+static inline uint8_t *_vfi_log_bits(uint8_t *bytes, uint64_t bits,
+                                     int nb_bytes) {
+  for (int i = 0; i < nb_bytes; i++)
+    *bytes++ = (uint8_t)(bits >> (8 * i));
+  return bytes;
+}
+
+static inline size_t _vfi_log_string_hash(const char *string) {
+  return (((uintptr_t)string >> 3) * 0x9e3779b97f4a7c15ULL) >> 32;
+}
+
+static void _vfi_log_strings_grow(void) {
+  size_t capacity = (_vfi_log.strings_capacity == 0)
+                        ? VFI_LOG_STRINGS_INIT_CAPACITY
+                        : 2 * _vfi_log.strings_capacity;
+  _vfi_log_string_t *strings =
+      interflop_calloc(capacity, sizeof(_vfi_log_string_t));
+  for (size_t i = 0; i < _vfi_log.strings_capacity; i++) {
+    const _vfi_log_string_t *entry = &_vfi_log.strings[i];
+    if (entry->string == NULL)
+      continue;
+    size_t j = _vfi_log_string_hash(entry->string) & (capacity - 1);
+    while (strings[j].string != NULL)
+      j = (j + 1) & (capacity - 1);
+    strings[j] = *entry;
+  }
+  interflop_free(_vfi_log.strings);
+  _vfi_log.strings = strings;
+  _vfi_log.strings_capacity = capacity;
+}
+
+/* return the id of string, defining it in the log at its first use. */
+/* Strings are identified by address, the ids live until the next reset */
+static uint64_t _vfi_log_string(const char *string) {
+  if (2 * (_vfi_log.nb_strings + 1) > _vfi_log.strings_capacity)
+    _vfi_log_strings_grow();
+
+  size_t mask = _vfi_log.strings_capacity - 1;
+  size_t i = _vfi_log_string_hash(string) & mask;
+  while (_vfi_log.strings[i].string != NULL) {
+    if (_vfi_log.strings[i].string == string)
+      return _vfi_log.strings[i].id;
+    i = (i + 1) & mask;
+  }
+
+  uint8_t header[1 + 10];
+  size_t length = strlen(string);
+  header[0] = VFI_LOG_TAG_STRING;
+  uint8_t *end = _vfi_log_varint(header + 1, length);
+  _vfi_log_put(header, end - header);
+  _vfi_log_put(string, length);
+
+  _vfi_log.strings[i].string = string;
+  _vfi_log.strings[i].id = _vfi_log.nb_strings++;
+  return _vfi_log.strings[i].id;
+}
+
+/* forget the strings, whose addresses may be reused once the profile is */
+/* unloaded, with a sync entry from which the log can be decoded */
+static void _vfi_log_reset(void) {
+  uint8_t sync[1 + sizeof(VFI_LOG_SYNC) - 1 + 8];
+  sync[0] = VFI_LOG_TAG_SYNC;
+  memcpy(sync + 1, VFI_LOG_SYNC, sizeof(VFI_LOG_SYNC) - 1);
+  _vfi_log_bits(sync + sizeof(VFI_LOG_SYNC), _vfi_log.offset, 8);
+  _vfi_log.sync_offset = _vfi_log.offset;
+  _vfi_log_put(sync, sizeof(sync));
+  if (_vfi_log.strings != NULL)
+    memset(_vfi_log.strings, 0,
+           _vfi_log.strings_capacity * sizeof(_vfi_log_string_t));
+  _vfi_log.nb_strings = 0;
+  _vfi_log.depth = 0;
+}
+
+/* encode a record in the binary format */
+static void _vfi_log_write_binary(const _vfi_log_record_t *record) {
+  if (_vfi_log.offset - _vfi_log.sync_offset >= VFI_LOG_SYNC_INTERVAL)
+    _vfi_log_reset();
+
+  uint64_t function = 0, arg_id = 0;
+  if (record->kind != vfilog_blank)
+    function = _vfi_log_string(record->function);
+  if (record->kind == vfilog_argument)
+    arg_id = _vfi_log_string(record->arg_id);
+
+  uint8_t bytes[VFI_LOG_RECORD_MAX];
+  uint8_t *end = bytes;
+  *end++ = (record->kind + 1) | (record->type << 3) | (record->is_input << 6) |
+           (record->is_null << 7);
+  end = _vfi_log_svarint(end, (int64_t)record->depth - _vfi_log.depth);
+  _vfi_log.depth = record->depth;
+
+  if (record->kind == vfilog_enter || record->kind == vfilog_exit) {
+    end = _vfi_log_varint(end, function);
+    for (int i = 0; i < 4; i++)
+      end = _vfi_log_svarint(end, record->lengths[i]);
+  } else if (record->kind == vfilog_argument) {
+    int nb_bytes =
+        (record->type == FDOUBLE || record->type == FDOUBLE_PTR) ? 8 : 4;
+    end = _vfi_log_varint(end, function);
+    end = _vfi_log_varint(end, arg_id);
+    if (record->type == FDOUBLE_PTR || record->type == FFLOAT_PTR)
+      end = _vfi_log_varint(end, record->index);
+    if (!record->is_null) {
+      end = _vfi_log_svarint(end, record->lengths[0]);
+      end = _vfi_log_svarint(end, record->lengths[1]);
+      end = _vfi_log_bits(end, record->before, nb_bytes);
+      end = _vfi_log_bits(end, record->after, nb_bytes);
+    }
+  }
+  _vfi_log_put(bytes, end - bytes);
+}
+
+/* write a record in the format of the log */
+static void _vfi_log_write(const _vfi_log_record_t *record) {
+  if (_vfi_log.format == vfilog_format_binary)
+    _vfi_log_write_binary(record);
+  else
+    _vfi_log_write_text(_vfi_log.file, record);
+}
+
+/* Writer thread */
+
+/* format the pending records of all the rings, return their number */
+static size_t _vfi_log_write_rings(void) {
+  size_t written = 0;
+  _vfi_log_ring_t *ring = __atomic_load_n(&_vfi_log.rings, __ATOMIC_ACQUIRE);
+  for (; ring != NULL; ring = ring->next) {
+    size_t tail = ring->tail;
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    while (tail != head) {
+      _vfi_log_write(&ring->records[tail & (VFI_LOG_RING_SIZE - 1)]);
+      tail++;
+      written++;
+      // release the slots early to unblock a producer waiting on a full ring,
+      // released records are in the file once the ring is drained
+      if (tail % VFI_LOG_BATCH == 0) {
+        _vfi_log_flush_buffer();
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+      }
+    }
+    _vfi_log_flush_buffer();
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+  }
+  return written;
+}
+
+static void *_vfi_log_writer(void *arg) {
+  (void)arg;
+  const struct timespec idle = {0, VFI_LOG_IDLE_NS};
+  for (;;) {
+    // records pushed before the stop request are seen by this pass
+    int stop = __atomic_load_n(&_vfi_log.stop, __ATOMIC_ACQUIRE);
+    if (_vfi_log_write_rings() == 0) {
+      if (stop)
+        break;
+      nanosleep(&idle, NULL);
+    }
+  }
+  return NULL;
+}
+
+/* allocate the ring of the calling thread and publish it to the writer */
+static _vfi_log_ring_t *_vfi_log_register(void) {
+  _vfi_log_ring_t *ring = interflop_malloc(sizeof(_vfi_log_ring_t));
+  ring->head = 0;
+  ring->tail = 0;
+  ring->next = __atomic_load_n(&_vfi_log.rings, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&_vfi_log.rings, &ring->next, ring, 1,
+                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    ;
+  _vfi_log_ring = ring;
+  return ring;
+}
+
+/* in a child forked while the writer thread runs, the records inherited */
+/* through fork are written by the parent and the child has no writer */
+/* thread: it writes its records itself, as without writer thread */
+static void _vfi_log_fork_child(void) {
+  if (!_vfi_log.running || _vfi_log.owner == _vprec_os_getpid())
+    return;
+  _vfi_log_ring_t *ring = _vfi_log.rings;
+  for (; ring != NULL; ring = ring->next)
+    ring->tail = ring->head;
+  _vfi_log.buffer_size = 0;
+  pthread_mutex_init(&_vfi_log.lock, NULL);
+  _vfi_log.running = false;
+}
+
+/* API */
+
+void _vfi_log_start(File *file, _vfi_log_format_t format, int new_file) {
+  if (!_vfi_log.atfork_registered)
+    _vfi_log.atfork_registered =
+        pthread_atfork(NULL, NULL, _vfi_log_fork_child) == 0;
+
+  _vfi_log.file = file;
+  _vfi_log.format = format;
+  if (format == vfilog_format_binary) {
+    if (_vfi_log.buffer == NULL)
+      _vfi_log.buffer = interflop_malloc(VFI_LOG_BUFFER_SIZE);
+    _vfi_log.buffer_size = 0;
+    if (new_file) {
+      uint8_t header[8] = VFI_LOG_MAGIC;
+      _vfi_log.offset = 0;
+      header[7] = VFI_LOG_VERSION;
+      _vfi_log_put(header, sizeof(header));
+    }
+    _vfi_log_reset();
+    _vfi_log_flush_buffer();
+  }
+
+  _vfi_log.stop = 0;
+  __atomic_store_n(&_vfi_log.closed, 0, __ATOMIC_RELEASE);
+  _vfi_log.owner = _vprec_os_getpid();
+  _vfi_log.running =
+      pthread_create(&_vfi_log.thread, NULL, _vfi_log_writer, NULL) == 0;
+  if (!_vfi_log.running) {
+    logger_warning("Can't create the log writer thread, the log is written "
+                   "by the instrumented threads\n");
+  }
+}
+
+void _vfi_log_push(const _vfi_log_record_t *record) {
+  if (__atomic_load_n(&_vfi_log.closed, __ATOMIC_ACQUIRE))
+    return;
+
+  if (!_vfi_log.running) {
+    pthread_mutex_lock(&_vfi_log.lock);
+    // the log may have been closed while waiting for the lock
+    if (!__atomic_load_n(&_vfi_log.closed, __ATOMIC_RELAXED)) {
+      _vfi_log_write(record);
+      _vfi_log_flush_buffer();
+    }
+    pthread_mutex_unlock(&_vfi_log.lock);
+    return;
+  }
+
+  _vfi_log_ring_t *ring = _vfi_log_ring;
+  if (ring == NULL)
+    ring = _vfi_log_register();
+
+  size_t head = ring->head;
+  while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) ==
+         VFI_LOG_RING_SIZE)
+    sched_yield();
+  ring->records[head & (VFI_LOG_RING_SIZE - 1)] = *record;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void _vfi_log_drain(void) {
+  if (!_vfi_log.running || _vfi_log.owner != _vprec_os_getpid())
+    return;
+  _vfi_log_ring_t *ring = __atomic_load_n(&_vfi_log.rings, __ATOMIC_ACQUIRE);
+  for (; ring != NULL; ring = ring->next) {
+    while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) !=
+           __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+      sched_yield();
+  }
+}
+
+void _vfi_log_stop(void) {
+  if (!_vfi_log.running)
+    return;
+
+  if (_vfi_log.owner != _vprec_os_getpid()) {
+    // forked without the atfork handler, see _vfi_log_fork_child
+    _vfi_log_fork_child();
+    return;
+  }
+  __atomic_store_n(&_vfi_log.stop, 1, __ATOMIC_RELEASE);
+  pthread_join(_vfi_log.thread, NULL);
+  _vfi_log.running = false;
+}
+
+void _vfi_log_close(void) {
+  _vfi_log_stop();
+  /* the rings are kept: other threads may still be pushing to theirs */
+  pthread_mutex_lock(&_vfi_log.lock);
+  __atomic_store_n(&_vfi_log.closed, 1, __ATOMIC_RELEASE);
+  interflop_free(_vfi_log.buffer);
+  _vfi_log.buffer = NULL;
+  interflop_free(_vfi_log.strings);
+  _vfi_log.strings = NULL;
+  _vfi_log.strings_capacity = 0;
+  _vfi_log.nb_strings = 0;
+  pthread_mutex_unlock(&_vfi_log.lock);
+}
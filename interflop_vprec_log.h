@@ -0,0 +1,123 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#ifndef __INTERFLOP_VPREC_LOG_H__
+#define __INTERFLOP_VPREC_LOG_H__
+
+#include <stdint.h>
+
+#include "interflop-stdlib/interflop_stdlib.h"
+
+/* define the formats of the log file */
+typedef enum {
+  vfilog_format_text,
+  vfilog_format_binary,
+  _vfilog_format_end_
+} _vfi_log_format_t;
+
+/******************** VPREC BINARY LOG ************************************
+ * The binary log starts with the 8 bytes VFI_LOG_MAGIC followed by the
+ * version, then holds a sequence of entries starting with a tag byte:
+ *  - VFI_LOG_TAG_STRING: varint length and bytes of the next string id,
+ *    ids are given in order of definition starting at 0
+ *  - VFI_LOG_TAG_RESET: forget all the strings, the depth restarts at 0
+ *    (version 1 only)
+ *  - VFI_LOG_TAG_SYNC: same as VFI_LOG_TAG_RESET, followed by the 7 bytes
+ *    of VFI_LOG_SYNC and the 8 bytes little-endian offset of the tag in
+ *    the file. A sync entry is written at least every
+ *    VFI_LOG_SYNC_INTERVAL bytes, the log can be decoded from any of them
+ *  - a record: the low 3 bits are the kind + 1, bits 3 to 5 the type,
+ *    bit 6 is_input and bit 7 is_null. It is followed by the zigzag
+ *    varint of the difference of depth with the previous record and by
+ *      enter and exit: function id varint and the 4 zigzag varint lengths
+ *      argument: function id and argument id varints, index varint for
+ *      pointer types, then unless is_null the 2 zigzag varint lengths and
+ *      the little-endian bits before and after rounding (8 bytes each for
+ *      binary64, 4 bytes for binary32)
+ * tools/vfi_log_decode.py converts a binary log to the text log and
+ * tools/vfi_log_replay.py splits it at the sync entries.
+ *************************************************************************/
+
+#define VFI_LOG_MAGIC "VFILOG"
+#define VFI_LOG_VERSION 2
+#define VFI_LOG_TAG_STRING 0
+#define VFI_LOG_TAG_RESET 5
+#define VFI_LOG_TAG_SYNC 6
+#define VFI_LOG_SYNC "VFISYNC"
+#define VFI_LOG_SYNC_INTERVAL (1 << 20)
+
+/* define the kinds of log records */
+typedef enum {
+  vfilog_blank,
+  vfilog_enter,
+  vfilog_exit,
+  vfilog_argument,
+  _vfilog_end_
+} _vfi_log_kind_t;
+
+// Raw record of the VFI log, formatted by the writer thread
+typedef struct {
+  // Kind of record (_vfi_log_kind_t)
+  uint8_t kind;
+  // Type of the argument (enum FTYPES)
+  uint8_t type;
+  // Indicate if the argument is an input
+  uint8_t is_input;
+  // Indicate if the pointer argument is NULL
+  uint8_t is_null;
+  // Depth of the function in the call stack
+  uint32_t depth;
+  // Element of a pointer argument
+  uint32_t index;
+  // Mantissa and exponent lengths of the argument, or OpsPrec64,
+  // OpsRange64, OpsPrec32 and OpsRange32 of the function
+  int32_t lengths[4];
+  // Id of the function, must live until the record is written
+  const char *function;
+  // Id of the argument, must live until the record is written
+  const char *arg_id;
+  // Bits of the argument before and after rounding
+  uint64_t before;
+  uint64_t after;
+} _vfi_log_record_t;
+
+/* Start the thread writing the records to file in the given format. The */
+/* header of the binary format is written if new_file is set. If the */
+/* thread can't be created, the records are written by the threads */
+/* pushing them */
+void _vfi_log_start(File *file, _vfi_log_format_t format, int new_file);
+
+/* Append a record to the ring of the calling thread, waiting for the */
+/* writer if the ring is full */
+void _vfi_log_push(const _vfi_log_record_t *record);
+
+/* Wait until all the records pushed so far are written to the file */
+void _vfi_log_drain(void);
+
+/* Write the pending records and stop the writer thread. In a forked child, */
+/* which does not inherit the writer, the pending records are dropped */
+void _vfi_log_stop(void);
+
+/* Stop the writer thread and drop the records pushed afterwards, so that */
+/* the file can be closed. The rings of the threads are not freed, since */
+/* the threads still running may be pushing to them */
+void _vfi_log_close(void);
+
+#endif /* __INTERFLOP_VPREC_LOG_H__ */
@@ -0,0 +1,262 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "interflop_vprec_os.h"
+
+pid_t _vprec_os_getpid(void) { return getpid(); }
+
+int _vprec_os_nb_cores(void) {
+  long nb_cores = sysconf(_SC_NPROCESSORS_ONLN);
+  return (nb_cores > 0) ? nb_cores : 1;
+}
+
+IBool _vprec_os_setenv(const char *name, const char *value, int *error) {
+  if (setenv(name, value, 1) == -1) {
+    *error = errno;
+    return false;
+  }
+  return true;
+}
+
+void _vprec_os_flush_streams(void) { fflush(NULL); }
+
+pid_t _vprec_os_fork(int *error) {
+  pid_t pid = fork();
+  if (pid == -1)
+    *error = errno;
+  return pid;
+}
+
+pid_t _vprec_os_wait_child(IBool *success, int *status, int *error) {
+  pid_t pid;
+  while ((pid = waitpid(-1, status, 0)) == -1 && errno == EINTR)
+    ;
+  if (pid == -1) {
+    *error = errno;
+    return -1;
+  }
+  *success = WIFEXITED(*status) && WEXITSTATUS(*status) == 0;
+  return pid;
+}
+
+void *_vprec_os_map_file(const char *path, size_t *size, int *error) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    *error = errno;
+    return NULL;
+  }
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &st) == -1)
+    *error = errno;
+  else if (st.st_size == 0)
+    *error = EINVAL;
+  else if ((data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) ==
+           MAP_FAILED)
+    *error = errno;
+  close(fd);
+  if (data == MAP_FAILED)
+    return NULL;
+  *size = st.st_size;
+  return data;
+}
+
+void _vprec_os_unmap_file(void *data, size_t size) { munmap(data, size); }
+
+int _vprec_os_create_file(const char *path, int *error) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd == -1)
+    *error = errno;
+  return fd;
+}
+
+IBool _vprec_os_write(int fd, const void *bytes, size_t size, int *error) {
+  const char *position = bytes;
+  while (size > 0) {
+    ssize_t written = write(fd, position, size);
+    if (written == -1 && errno != EINTR) {
+      *error = errno;
+      return false;
+    } else if (written > 0) {
+      position += written;
+      size -= written;
+    }
+  }
+  return true;
+}
+
+IBool _vprec_os_close_file(int fd, IBool sync, int *error) {
+  IBool success = true;
+  if (sync && fsync(fd) == -1) {
+    *error = errno;
+    success = false;
+  }
+  if (close(fd) == -1 && success) {
+    *error = errno;
+    success = false;
+  }
+  return success;
+}
+
+/* flush the entries of the directory of path to disk */
+static IBool _vprec_os_sync_directory(const char *path, int *error) {
+  const char *slash = strrchr(path, '/');
+  size_t len = (slash == NULL || slash == path) ? 1 : slash - path;
+  char *directory = interflop_malloc(len + 1);
+  memcpy(directory, (slash == NULL) ? "." : path, len);
+  directory[len] = '\0';
+
+  IBool success = true;
+  int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1) {
+    *error = errno;
+    success = false;
+  } else {
+    /* some file systems can't sync directories, their entries are safe */
+    if (fsync(fd) == -1 && errno != EINVAL) {
+      *error = errno;
+      success = false;
+    }
+    close(fd);
+  }
+  interflop_free(directory);
+  return success;
+}
+
+IBool _vprec_os_replace_file(const char *from, const char *to, int *error) {
+  if (rename(from, to) == -1) {
+    *error = errno;
+    return false;
+  }
+  return _vprec_os_sync_directory(to, error);
+}
+
+void _vprec_os_remove_file(const char *path) { unlink(path); }
+
+uid_t _vprec_os_getuid(void) { return getuid(); }
+
+size_t _vprec_os_page_size(void) { return sysconf(_SC_PAGESIZE); }
+
+void _vprec_os_sleep_ms(int ms) {
+  struct timespec delay = {ms / 1000, (ms % 1000) * 1000 * 1000};
+  while (nanosleep(&delay, &delay) == -1 && errno == EINTR)
+    ;
+}
+
+int _vprec_os_open_file(const char *path, int *error) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    *error = errno;
+  return fd;
+}
+
+long _vprec_os_read(int fd, void *bytes, size_t size, int *error) {
+  char *position = bytes;
+  size_t done = 0;
+  while (done < size) {
+    ssize_t nb = read(fd, position + done, size - done);
+    if (nb == -1 && errno != EINTR) {
+      *error = errno;
+      return -1;
+    } else if (nb == 0) {
+      break;
+    } else if (nb > 0) {
+      done += nb;
+    }
+  }
+  return done;
+}
+
+IBool _vprec_os_file_info(int fd, _vprec_os_file_info_t *info, int *error) {
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    *error = errno;
+    return false;
+  }
+  info->dev = st.st_dev;
+  info->ino = st.st_ino;
+  info->size = st.st_size;
+  info->nlink = st.st_nlink;
+  info->regular = S_ISREG(st.st_mode);
+  info->mtime_sec = st.st_mtim.tv_sec;
+  info->mtime_nsec = st.st_mtim.tv_nsec;
+  return true;
+}
+
+IBool _vprec_os_resize_file(int fd, size_t size, IBool allocate, int *error) {
+  if (allocate) {
+    int result = posix_fallocate(fd, 0, size);
+    if (result != 0) {
+      *error = result;
+      return false;
+    }
+    return true;
+  }
+  if (ftruncate(fd, size) == -1) {
+    *error = errno;
+    return false;
+  }
+  return true;
+}
+
+IBool _vprec_os_lock_file(int fd, IBool exclusive, int *error) {
+  while (flock(fd, exclusive ? LOCK_EX : LOCK_SH) == -1) {
+    if (errno != EINTR) {
+      *error = errno;
+      return false;
+    }
+  }
+  return true;
+}
+
+void _vprec_os_unlock_file(int fd) { flock(fd, LOCK_UN); }
+
+void *_vprec_os_map_shared(int fd, size_t size, size_t offset, IBool writable,
+                           int *error) {
+  int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *data = mmap(NULL, size, protection, MAP_SHARED, fd, offset);
+  if (data == MAP_FAILED) {
+    *error = errno;
+    return NULL;
+  }
+  return data;
+}
+
+int _vprec_os_shm_open(const char *name, IBool create, int *error) {
+  int flags = create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR;
+  int fd = shm_open(name, flags, 0600);
+  if (fd == -1)
+    *error = errno;
+  return fd;
+}
+
+void _vprec_os_shm_unlink(const char *name) { shm_unlink(name); }
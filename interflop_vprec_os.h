@@ -0,0 +1,138 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#ifndef __INTERFLOP_VPREC_OS_H__
+#define __INTERFLOP_VPREC_OS_H__
+
+#include <sys/types.h>
+
+#include "interflop-stdlib/interflop_stdlib.h"
+
+/******************** VPREC OPERATING SYSTEM CALLS **********************
+ * The interflop stdlib wraps the stream I/O, memory and string functions
+ * used by the backends. The few process calls it does not cover are
+ * gathered here, so that the rest of the backend only goes through
+ * interflop_* and _vprec_os_* functions. On failure, the functions that
+ * take an error argument set it to the errno value of the failure.
+ *************************************************************************/
+
+/* Pid of the calling process */
+pid_t _vprec_os_getpid(void);
+
+/* Number of online cores, 1 if unknown */
+int _vprec_os_nb_cores(void);
+
+/* Set the environment variable name to value, return false on failure */
+IBool _vprec_os_setenv(const char *name, const char *value, int *error);
+
+/* Flush all the output streams of the process, so that forked children do */
+/* not write their buffered data again */
+void _vprec_os_flush_streams(void);
+
+/* Fork the process, return the pid of the child in the parent, 0 in the */
+/* child and -1 on failure */
+pid_t _vprec_os_fork(int *error);
+
+/* Wait for any child, return its pid or -1 on failure. success is set to */
+/* true if the child exited with status 0, status to its raw wait status */
+pid_t _vprec_os_wait_child(IBool *success, int *status, int *error);
+
+/* Map the file path read-only, return its address and set size to its */
+/* size, or NULL on failure. Empty files are not mapped (EINVAL) */
+void *_vprec_os_map_file(const char *path, size_t *size, int *error);
+
+/* Unmap a file mapped by _vprec_os_map_file or _vprec_os_map_shared */
+void _vprec_os_unmap_file(void *data, size_t size);
+
+/* Create or truncate the file path for writing, return its descriptor or */
+/* -1 on failure */
+int _vprec_os_create_file(const char *path, int *error);
+
+/* Write size bytes to fd, retrying on partial writes, return false on */
+/* failure */
+IBool _vprec_os_write(int fd, const void *bytes, size_t size, int *error);
+
+/* Flush fd to disk and close it, or only close it if sync is false. The */
+/* descriptor is closed even on failure */
+IBool _vprec_os_close_file(int fd, IBool sync, int *error);
+
+/* Rename from to to and flush the entries of the directory of to to disk, */
+/* so that the renaming survives a crash of the machine */
+IBool _vprec_os_replace_file(const char *from, const char *to, int *error);
+
+/* Remove the file path, failures are ignored */
+void _vprec_os_remove_file(const char *path);
+
+/* Identity and state of an open file */
+typedef struct {
+  dev_t dev;
+  ino_t ino;
+  size_t size;
+  /* number of names of the file, 0 once it is unlinked */
+  size_t nlink;
+  IBool regular;
+  long long mtime_sec;
+  long mtime_nsec;
+} _vprec_os_file_info_t;
+
+/* User id of the calling process */
+uid_t _vprec_os_getuid(void);
+
+/* Size of a memory page */
+size_t _vprec_os_page_size(void);
+
+/* Sleep for ms milliseconds */
+void _vprec_os_sleep_ms(int ms);
+
+/* Open the file path for reading, return its descriptor or -1 on failure */
+int _vprec_os_open_file(const char *path, int *error);
+
+/* Read at most size bytes of fd, return the number of bytes read or -1 on */
+/* failure */
+long _vprec_os_read(int fd, void *bytes, size_t size, int *error);
+
+/* Fill info with the state of fd, return false on failure */
+IBool _vprec_os_file_info(int fd, _vprec_os_file_info_t *info, int *error);
+
+/* Set the size of fd to size, reserving its blocks if allocate is true so */
+/* that writing a mapping of the file can't run out of space */
+IBool _vprec_os_resize_file(int fd, size_t size, IBool allocate, int *error);
+
+/* Lock fd, shared or exclusive, waiting for the other locks to be */
+/* released. The lock is released when the descriptor is closed */
+IBool _vprec_os_lock_file(int fd, IBool exclusive, int *error);
+
+/* Release the lock of fd */
+void _vprec_os_unlock_file(int fd);
+
+/* Map size bytes of fd from offset, shared with the other processes */
+/* mapping it, return NULL on failure */
+void *_vprec_os_map_shared(int fd, size_t size, size_t offset, IBool writable,
+                           int *error);
+
+/* Open the POSIX shared memory segment name for reading and writing, */
+/* creating it if create is true (EEXIST if it exists). Return its */
+/* descriptor or -1 on failure */
+int _vprec_os_shm_open(const char *name, IBool create, int *error);
+
+/* Remove the name of a shared memory segment, failures are ignored */
+void _vprec_os_shm_unlink(const char *name);
+
+#endif /* __INTERFLOP_VPREC_OS_H__ */
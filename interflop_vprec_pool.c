@@ -0,0 +1,153 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "interflop-stdlib/interflop_stdlib.h"
+#include "interflop_vprec_pool.h"
+
+/******************** VPREC WORKER POOL *********************************
+ * Workers are created once and sleep between jobs. A job is a number of
+ * independent tasks handed out one at a time, so that the caller and the
+ * workers balance the load. Jobs are serialized: a thread finding the
+ * pool busy runs its tasks alone instead of waiting.
+ *************************************************************************/
+
+struct _vprec_pool {
+  pthread_t *threads;
+  int nb_workers;
+  /* process owning the workers, a forked child has none */
+  pid_t owner;
+  /* held by the thread submitting the current job */
+  pthread_mutex_t job_lock;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t finished;
+  /* current job */
+  _vprec_pool_task_t task;
+  void *arg;
+  int nb_tasks;
+  int next_task;
+  int nb_done;
+  /* incremented for each job, workers wait for it to change */
+  unsigned long generation;
+  IBool stop;
+};
+
+/* run the remaining tasks of the current job, lock is held on entry/exit */
+static void _vprec_pool_work(_vprec_pool_t *pool) {
+  while (pool->next_task < pool->nb_tasks) {
+    int k = pool->next_task++;
+    pthread_mutex_unlock(&pool->lock);
+    pool->task(pool->arg, k);
+    pthread_mutex_lock(&pool->lock);
+    if (++pool->nb_done == pool->nb_tasks)
+      pthread_cond_signal(&pool->finished);
+  }
+}
+
+static void *_vprec_pool_worker(void *arg) {
+  _vprec_pool_t *pool = (_vprec_pool_t *)arg;
+  unsigned long generation = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  while (1) {
+    while (!pool->stop && pool->generation == generation)
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    if (pool->stop)
+      break;
+    generation = pool->generation;
+    _vprec_pool_work(pool);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+_vprec_pool_t *_vprec_pool_create(int nb_threads) {
+  _vprec_pool_t *pool = interflop_malloc(sizeof(_vprec_pool_t));
+  pool->nb_workers = 0;
+  pool->threads = interflop_malloc(nb_threads * sizeof(pthread_t));
+  pool->owner = getpid();
+  pthread_mutex_init(&pool->job_lock, NULL);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->finished, NULL);
+  pool->task = NULL;
+  pool->arg = NULL;
+  pool->nb_tasks = 0;
+  pool->next_task = 0;
+  pool->nb_done = 0;
+  pool->generation = 0;
+  pool->stop = false;
+
+  for (int i = 0; i < nb_threads - 1; i++) {
+    if (pthread_create(&pool->threads[i], NULL, _vprec_pool_worker, pool) !=
+        0) {
+      _vprec_pool_destroy(pool);
+      return NULL;
+    }
+    pool->nb_workers++;
+  }
+  return pool;
+}
+
+void _vprec_pool_run(_vprec_pool_t *pool, int nb_tasks,
+                     _vprec_pool_task_t task, void *arg) {
+  if (pool->owner != getpid() || pthread_mutex_trylock(&pool->job_lock) != 0) {
+    for (int k = 0; k < nb_tasks; k++)
+      task(arg, k);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->task = task;
+  pool->arg = arg;
+  pool->nb_tasks = nb_tasks;
+  pool->next_task = 0;
+  pool->nb_done = 0;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->wake);
+
+  _vprec_pool_work(pool);
+  while (pool->nb_done < pool->nb_tasks)
+    pthread_cond_wait(&pool->finished, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+
+  pthread_mutex_unlock(&pool->job_lock);
+}
+
+int _vprec_pool_size(const _vprec_pool_t *pool) {
+  return pool->nb_workers + 1;
+}
+
+void _vprec_pool_destroy(_vprec_pool_t *pool) {
+  /* the workers of a pool inherited through fork do not exist */
+  if (pool->owner == getpid()) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->nb_workers; i++)
+      pthread_join(pool->threads[i], NULL);
+  }
+  interflop_free(pool->threads);
+  interflop_free(pool);
+}
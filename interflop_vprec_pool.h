@@ -0,0 +1,47 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#ifndef __INTERFLOP_VPREC_POOL_H__
+#define __INTERFLOP_VPREC_POOL_H__
+
+/* Persistent pool of worker threads running the tasks of one job at a time */
+typedef struct _vprec_pool _vprec_pool_t;
+
+/* Task k of a job, called with the argument given to _vprec_pool_run */
+typedef void (*_vprec_pool_task_t)(void *arg, int k);
+
+/* Create a pool of nb_threads - 1 workers, the caller being the last one. */
+/* Return NULL if the workers can't be created */
+_vprec_pool_t *_vprec_pool_create(int nb_threads);
+
+/* Run the nb_tasks tasks of a job and return once all of them are done. */
+/* The calling thread runs tasks too. If the pool is busy with the job of */
+/* another thread or was inherited through fork, all the tasks are run by */
+/* the calling thread */
+void _vprec_pool_run(_vprec_pool_t *pool, int nb_tasks,
+                     _vprec_pool_task_t task, void *arg);
+
+/* Number of threads running the tasks, including the caller */
+int _vprec_pool_size(const _vprec_pool_t *pool);
+
+/* Stop the workers and free the pool */
+void _vprec_pool_destroy(_vprec_pool_t *pool);
+
+#endif /* __INTERFLOP_VPREC_POOL_H__ */
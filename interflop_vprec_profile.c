@@ -0,0 +1,280 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#include <string.h>
+
+#include "interflop-stdlib/interflop_stdlib.h"
+#include "interflop_vprec_profile.h"
+
+/******************** VPREC COMPILED PROFILES ****************************
+ * A profile can be compiled (see tools/vfi_compile_profile.py) into a
+ * shared object exporting a read-only table of fixed-size records and a
+ * minimal perfect hash over the function ids. The hash is of the
+ * hash-and-displace family: the id is hashed once, the hash selects a
+ * bucket and the seed of the bucket displaces it to a unique slot.
+ * The same hash is built at init over the ids of text profiles. Binary
+ * profiles hold the same tables in a file mapped in memory.
+ *************************************************************************/
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+#define GOLDEN_RATIO 0x9e3779b97f4a7c15ULL
+
+/* average number of ids per bucket */
+#define VFI_MPH_BUCKET_SIZE 3
+/* buckets with more ids make the construction fail */
+#define VFI_MPH_MAX_BUCKET 64
+/* number of seeds tried per bucket before giving up */
+#define VFI_MPH_MAX_SEED (1 << 20)
+
+/* splitmix64 finalizer */
+static inline uint64_t _vfi_profile_mix(uint64_t z) {
+  z ^= z >> 30;
+  z *= 0xbf58476d1ce4e5b9ULL;
+  z ^= z >> 27;
+  z *= 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  return z;
+}
+
+/* FNV-1a */
+uint64_t _vfi_profile_hash(const char *id) {
+  uint64_t hash = FNV_OFFSET_BASIS;
+  for (const unsigned char *c = (const unsigned char *)id; *c; c++) {
+    hash ^= *c;
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+uint32_t _vfi_mph_lookup(const _vfi_mph_t *mph, const char *id) {
+  uint64_t hash = _vfi_profile_hash(id);
+  uint32_t bucket = _vfi_profile_mix(hash) % mph->nb_buckets;
+  uint64_t seed = mph->seeds[bucket];
+  return _vfi_profile_mix(hash ^ (seed * GOLDEN_RATIO)) % mph->nb_keys;
+}
+
+uint32_t _vfi_find_duplicate(const char *const *ids, uint32_t nb_keys) {
+  /* open addressing table of indices in ids, at most half full */
+  uint64_t size = 2;
+  while (size < 2 * (uint64_t)nb_keys)
+    size *= 2;
+  uint32_t *table = interflop_malloc(size * sizeof(uint32_t));
+  for (uint64_t i = 0; i < size; i++)
+    table[i] = UINT32_MAX;
+
+  uint32_t duplicate = nb_keys;
+  for (uint32_t i = 0; i < nb_keys && duplicate == nb_keys; i++) {
+    uint64_t slot = _vfi_profile_mix(_vfi_profile_hash(ids[i])) & (size - 1);
+    while (table[slot] != UINT32_MAX) {
+      if (interflop_strcmp(ids[table[slot]], ids[i]) == 0) {
+        duplicate = i;
+        break;
+      }
+      slot = (slot + 1) & (size - 1);
+    }
+    table[slot] = i;
+  }
+
+  interflop_free(table);
+  return duplicate;
+}
+
+int _vfi_mph_build(_vfi_mph_t *mph, const char *const *ids, uint32_t nb_keys,
+                   uint32_t *order) {
+  uint32_t nb_buckets = nb_keys / VFI_MPH_BUCKET_SIZE + 1;
+
+  uint64_t *hashes = interflop_malloc(nb_keys * sizeof(uint64_t));
+  uint32_t *bucket_of = interflop_malloc(nb_keys * sizeof(uint32_t));
+  uint32_t *bucket_start = interflop_calloc(nb_buckets + 1, sizeof(uint32_t));
+  uint32_t *keys = interflop_malloc(nb_keys * sizeof(uint32_t));
+  uint32_t *buckets = interflop_malloc(nb_buckets * sizeof(uint32_t));
+  uint32_t *slots = interflop_malloc(VFI_MPH_MAX_BUCKET * sizeof(uint32_t));
+  uint32_t *seeds = interflop_calloc(nb_buckets, sizeof(uint32_t));
+  int status = 0;
+
+  /* sort the keys by bucket */
+  for (uint32_t i = 0; i < nb_keys; i++) {
+    hashes[i] = _vfi_profile_hash(ids[i]);
+    bucket_of[i] = _vfi_profile_mix(hashes[i]) % nb_buckets;
+    bucket_start[bucket_of[i] + 1]++;
+  }
+  for (uint32_t b = 0; b < nb_buckets; b++)
+    bucket_start[b + 1] += bucket_start[b];
+  uint32_t *fill = interflop_malloc(nb_buckets * sizeof(uint32_t));
+  for (uint32_t b = 0; b < nb_buckets; b++)
+    fill[b] = bucket_start[b];
+  for (uint32_t i = 0; i < nb_keys; i++)
+    keys[fill[bucket_of[i]]++] = i;
+
+  /* sort the buckets by decreasing size: largest buckets are the hardest */
+  /* to place and are placed while the table is still empty */
+  uint32_t nb_sorted = 0;
+  for (uint32_t size = VFI_MPH_MAX_BUCKET; size > 0; size--)
+    for (uint32_t b = 0; b < nb_buckets; b++)
+      if (bucket_start[b + 1] - bucket_start[b] == size)
+        buckets[nb_sorted++] = b;
+  for (uint32_t b = 0; b < nb_buckets; b++)
+    if (bucket_start[b + 1] - bucket_start[b] > VFI_MPH_MAX_BUCKET)
+      status = -1;
+
+  for (uint32_t i = 0; i < nb_keys; i++)
+    order[i] = UINT32_MAX;
+
+  /* find a seed for each bucket placing all its keys on free slots */
+  for (uint32_t i = 0; i < nb_sorted && status == 0; i++) {
+    uint32_t b = buckets[i];
+    uint32_t size = bucket_start[b + 1] - bucket_start[b];
+    const uint32_t *bucket_keys = keys + bucket_start[b];
+
+    uint64_t seed;
+    for (seed = 0; seed < VFI_MPH_MAX_SEED; seed++) {
+      uint32_t placed = 0;
+      for (; placed < size; placed++) {
+        uint32_t slot =
+            _vfi_profile_mix(hashes[bucket_keys[placed]] ^
+                             (seed * GOLDEN_RATIO)) %
+            nb_keys;
+        if (order[slot] != UINT32_MAX)
+          break;
+        order[slot] = bucket_keys[placed];
+        slots[placed] = slot;
+      }
+      if (placed == size)
+        break;
+      /* collision: release the slots taken by this seed */
+      for (uint32_t k = 0; k < placed; k++)
+        order[slots[k]] = UINT32_MAX;
+    }
+
+    if (seed == VFI_MPH_MAX_SEED)
+      status = -1;
+    seeds[b] = seed;
+  }
+
+  interflop_free(hashes);
+  interflop_free(bucket_of);
+  interflop_free(bucket_start);
+  interflop_free(keys);
+  interflop_free(buckets);
+  interflop_free(slots);
+  interflop_free(fill);
+
+  if (status != 0) {
+    interflop_free(seeds);
+    return status;
+  }
+
+  mph->nb_keys = nb_keys;
+  mph->nb_buckets = nb_buckets;
+  mph->seeds = seeds;
+  return 0;
+}
+
+void _vfi_mph_free(_vfi_mph_t *mph) {
+  interflop_free((void *)mph->seeds);
+  mph->seeds = NULL;
+  mph->nb_keys = 0;
+  mph->nb_buckets = 0;
+}
+
+int _vfi_profile_check(const _vfi_profile_t *profile) {
+  return profile->version == VFI_PROFILE_VERSION &&
+         profile->function_record_size == sizeof(_vfi_profile_function_t) &&
+         profile->argument_record_size == sizeof(_vfi_profile_argument_t);
+}
+
+int _vfi_profile_is_binary(const void *data, size_t size) {
+  return size >= sizeof(VFI_PROFILE_MAGIC) &&
+         memcmp(data, VFI_PROFILE_MAGIC, sizeof(VFI_PROFILE_MAGIC)) == 0;
+}
+
+/* true if nb elements of element_size bytes at offset are within the size */
+/* bytes of the file and aligned */
+static int _vfi_profile_section(size_t size, uint64_t offset, uint64_t nb,
+                                uint64_t element_size) {
+  return offset % 8 == 0 && offset <= size &&
+         nb <= (size - offset) / element_size;
+}
+
+int _vfi_profile_map(const void *data, size_t size, _vfi_profile_t *profile) {
+  const _vfi_profile_file_t *header = (const _vfi_profile_file_t *)data;
+
+  if (size < sizeof(_vfi_profile_file_t) ||
+      !_vfi_profile_is_binary(data, size) ||
+      header->version != VFI_PROFILE_VERSION ||
+      header->function_record_size != sizeof(_vfi_profile_function_t) ||
+      header->argument_record_size != sizeof(_vfi_profile_argument_t))
+    return -1;
+
+  if (!_vfi_profile_section(size, header->seeds, header->nb_buckets,
+                            sizeof(uint32_t)) ||
+      !_vfi_profile_section(size, header->functions, header->nb_functions,
+                            sizeof(_vfi_profile_function_t)) ||
+      !_vfi_profile_section(size, header->arguments, header->nb_arguments,
+                            sizeof(_vfi_profile_argument_t)) ||
+      !_vfi_profile_section(size, header->histograms, header->nb_arguments,
+                            VFI_PROFILE_HIST_BINS * sizeof(uint64_t)) ||
+      !_vfi_profile_section(size, header->index, header->nb_functions,
+                            sizeof(uint32_t)) ||
+      !_vfi_profile_section(size, header->strings, header->strings_size, 1))
+    return -1;
+
+  const char *base = (const char *)data;
+  const char *strings = base + header->strings;
+  const _vfi_profile_function_t *functions =
+      (const _vfi_profile_function_t *)(base + header->functions);
+  const _vfi_profile_argument_t *arguments =
+      (const _vfi_profile_argument_t *)(base + header->arguments);
+  const uint32_t *index = (const uint32_t *)(base + header->index);
+
+  if ((header->nb_functions > 0 && header->nb_buckets == 0) ||
+      header->strings_size == 0 || strings[header->strings_size - 1] != '\0')
+    return -1;
+
+  /* every offset and count of the records is used without check later */
+  for (uint32_t i = 0; i < header->nb_functions; i++) {
+    const _vfi_profile_function_t *function = &functions[i];
+    if (function->id >= header->strings_size || function->nb_input_args < 0 ||
+        function->nb_output_args < 0 ||
+        (uint64_t)function->first_arg + function->nb_input_args +
+                function->nb_output_args >
+            header->nb_arguments ||
+        index[i] >= header->nb_functions)
+      return -1;
+  }
+  for (uint32_t i = 0; i < header->nb_arguments; i++) {
+    if (arguments[i].arg_id >= header->strings_size)
+      return -1;
+  }
+
+  profile->version = header->version;
+  profile->function_record_size = header->function_record_size;
+  profile->argument_record_size = header->argument_record_size;
+  profile->nb_functions = header->nb_functions;
+  profile->nb_arguments = header->nb_arguments;
+  profile->nb_buckets = header->nb_buckets;
+  profile->seeds = (const uint32_t *)(base + header->seeds);
+  profile->functions = functions;
+  profile->arguments = arguments;
+  profile->histograms = (const uint64_t *)(base + header->histograms);
+  profile->strings = strings;
+  return 0;
+}
@@ -0,0 +1,174 @@
+/*****************************************************************************\
+ *                                                                           *\
+ *  This file is part of the Verificarlo project,                            *\
+ *  under the Apache License v2.0 with LLVM Exceptions.                      *\
+ *  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 *\
+ *  See https://llvm.org/LICENSE.txt for license information.                *\
+ *                                                                           *\
+ *                                                                           *\
+ *  Copyright (c) 2015                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *     CMLA, Ecole Normale Superieure de Cachan                              *\
+ *                                                                           *\
+ *  Copyright (c) 2018                                                       *\
+ *     Universite de Versailles St-Quentin-en-Yvelines                       *\
+ *                                                                           *\
+ *  Copyright (c) 2019-2022                                                  *\
+ *     Verificarlo Contributors                                              *\
+ *                                                                           *\
+ ****************************************************************************/
+
+#ifndef __INTERFLOP_VPREC_PROFILE_H__
+#define __INTERFLOP_VPREC_PROFILE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* version of the compiled and binary profile layouts */
+#define VFI_PROFILE_VERSION 2
+
+/* name of the symbol exported by compiled profiles */
+#define VFI_PROFILE_SYMBOL "vfi_profile"
+
+/* first bytes of binary profiles */
+#define VFI_PROFILE_MAGIC "VFIPROF"
+
+/* number of bins of the exponent histogram of an argument */
+#define VFI_PROFILE_HIST_BINS 24
+
+// Fixed-size record of a function
+typedef struct {
+  // Offset of the function id in the string table
+  uint32_t id;
+  // Indicate if the function is from library
+  int16_t isLibraryFunction;
+  // Indicate if the function is intrinsic
+  int16_t isIntrinsicFunction;
+  // Counter of Floating Point instruction
+  int64_t useFloat;
+  // Counter of Floating Point instruction
+  int64_t useDouble;
+  // Internal Operations precision and range
+  int32_t OpsPrec64;
+  int32_t OpsRange64;
+  int32_t OpsPrec32;
+  int32_t OpsRange32;
+  // Number of floating point input and output arguments
+  int32_t nb_input_args;
+  int32_t nb_output_args;
+  // Index of the first input argument, output arguments follow the inputs
+  uint32_t first_arg;
+  // Number of call for this call site
+  int32_t n_calls;
+} _vfi_profile_function_t;
+
+// Fixed-size record of an argument
+typedef struct {
+  // Offset of the argument id in the string table
+  uint32_t arg_id;
+  // Data type of the argument
+  int32_t data_type;
+  int32_t mantissa_length;
+  int32_t exponent_length;
+  int32_t min_range;
+  int32_t max_range;
+} _vfi_profile_argument_t;
+
+// Minimal perfect hash over a fixed set of function ids
+typedef struct {
+  // number of ids, also the number of slots
+  uint32_t nb_keys;
+  // number of buckets
+  uint32_t nb_buckets;
+  // seed of each bucket
+  const uint32_t *seeds;
+} _vfi_mph_t;
+
+// Read-only profile with a minimal perfect hash over the function ids
+typedef struct {
+  uint32_t version;
+  // sizes of the records, checked against the backend ones
+  uint32_t function_record_size;
+  uint32_t argument_record_size;
+  uint32_t nb_functions;
+  uint32_t nb_arguments;
+  // number of buckets of the minimal perfect hash
+  uint32_t nb_buckets;
+  // seed of each bucket of the minimal perfect hash
+  const uint32_t *seeds;
+  const _vfi_profile_function_t *functions;
+  const _vfi_profile_argument_t *arguments;
+  // VFI_PROFILE_HIST_BINS bins of the exponent histogram of each argument
+  const uint64_t *histograms;
+  const char *strings;
+} _vfi_profile_t;
+
+/******************** VPREC BINARY PROFILES *******************************
+ * A binary profile (see tools/vfi_convert_profile.py) holds the tables of
+ * a compiled profile in a file that is mapped in memory and used in place.
+ * It starts with a _vfi_profile_file_t header giving the offset of each
+ * section from the start of the file, sections are aligned on 8 bytes:
+ *  - seeds: nb_buckets uint32_t, seeds of the minimal perfect hash
+ *  - functions: nb_functions records ordered by slot of the perfect hash
+ *  - arguments: nb_arguments records
+ *  - histograms: VFI_PROFILE_HIST_BINS uint64_t per argument
+ *  - index: nb_functions uint32_t, slots of the functions ordered by id
+ *  - strings: strings_size bytes of NUL-terminated strings
+ * Integers are stored in the byte order of the machine reading the file.
+ * With --prec-input-shared, text profiles are written in this layout to a
+ * shared memory segment mapped by all the processes of the node.
+ *************************************************************************/
+
+// Header of a binary profile
+typedef struct {
+  // VFI_PROFILE_MAGIC and its NUL terminator
+  char magic[8];
+  uint32_t version;
+  // sizes of the records, checked against the backend ones
+  uint32_t function_record_size;
+  uint32_t argument_record_size;
+  uint32_t nb_functions;
+  uint32_t nb_arguments;
+  uint32_t nb_buckets;
+  // offsets of the sections
+  uint64_t seeds;
+  uint64_t functions;
+  uint64_t arguments;
+  uint64_t histograms;
+  uint64_t index;
+  uint64_t strings;
+  uint64_t strings_size;
+} _vfi_profile_file_t;
+
+/* Hash of a function id, shared by the profile compiler and the backend */
+uint64_t _vfi_profile_hash(const char *id);
+
+/* Return the only slot where id can be stored, the caller must compare the */
+/* id stored at this slot with id since unknown ids also map to a slot */
+uint32_t _vfi_mph_lookup(const _vfi_mph_t *mph, const char *id);
+
+/* Return the index of the first id of ids already seen earlier in ids, or */
+/* nb_keys if all the ids are distinct */
+uint32_t _vfi_find_duplicate(const char *const *ids, uint32_t nb_keys);
+
+/* Build a minimal perfect hash over nb_keys distinct ids. order[slot] is set */
+/* to the index in ids of the id stored at slot. Return 0 upon success, -1 if */
+/* no perfect hash was found */
+int _vfi_mph_build(_vfi_mph_t *mph, const char *const *ids, uint32_t nb_keys,
+                   uint32_t *order);
+
+/* Free the seeds of a minimal perfect hash built by _vfi_mph_build */
+void _vfi_mph_free(_vfi_mph_t *mph);
+
+/* Check that a compiled profile matches the layout of the backend */
+int _vfi_profile_check(const _vfi_profile_t *profile);
+
+/* Return 1 if the size bytes at data start like a binary profile */
+int _vfi_profile_is_binary(const void *data, size_t size);
+
+/* Point profile to the tables of the binary profile mapped at data, after */
+/* checking that they lie within its size bytes. Return 0 upon success, */
+/* -1 if the file is corrupted or was written for another layout */
+int _vfi_profile_map(const void *data, size_t size, _vfi_profile_t *profile);
+
+#endif /* __INTERFLOP_VPREC_PROFILE_H__ */
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+#############################################################################
+#                                                                           #
+#  This file is part of the Verificarlo project,                            #
+#  under the Apache License v2.0 with LLVM Exceptions.                      #
+#  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 #
+#  See https://llvm.org/LICENSE.txt for license information.                #
+#                                                                           #
+#  Copyright (c) 2019-2022                                                  #
+#     Verificarlo Contributors                                              #
+#                                                                           #
+#############################################################################
+"""Compile a VFI text profile into a shared object.
+
+The generated C source holds the profile as static tables of fixed-size
+records (see interflop_vprec_profile.h) and a minimal perfect hash over the
+function ids. Passing the resulting .so to --prec-input-file lets the backend
+dlopen it instead of parsing the text profile: startup and lookups are
+constant time, with no allocation. vfi_convert_profile.py writes the same
+tables to a binary profile, mapped in memory without a compiler.
+
+Example:
+  vfi_compile_profile.py profile.vfi -o profile.so
+"""
+
+import argparse
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+
+import vfi_profile
+
+
+def c_string(data, width=72):
+    """Split data into C string literals"""
+    lines = []
+    line = ""
+    for byte in data:
+        if byte in b'"\\':
+            line += "\\" + chr(byte)
+        elif 32 <= byte < 127:
+            line += chr(byte)
+        else:
+            # octal escapes are at most 3 digits long
+            line += "\\%03o" % byte
+        if len(line) >= width:
+            lines.append('    "%s"' % line)
+            line = ""
+    if line:
+        lines.append('    "%s"' % line)
+    return "\n".join(lines) if lines else '    ""'
+
+
+PREAMBLE = """\
+/* Generated by vfi_compile_profile.py from %(source)s, do not edit */
+#include <stdint.h>
+
+typedef struct {
+  uint32_t id;
+  int16_t isLibraryFunction;
+  int16_t isIntrinsicFunction;
+  int64_t useFloat;
+  int64_t useDouble;
+  int32_t OpsPrec64;
+  int32_t OpsRange64;
+  int32_t OpsPrec32;
+  int32_t OpsRange32;
+  int32_t nb_input_args;
+  int32_t nb_output_args;
+  uint32_t first_arg;
+  int32_t n_calls;
+} _vfi_profile_function_t;
+
+typedef struct {
+  uint32_t arg_id;
+  int32_t data_type;
+  int32_t mantissa_length;
+  int32_t exponent_length;
+  int32_t min_range;
+  int32_t max_range;
+} _vfi_profile_argument_t;
+
+typedef struct {
+  uint32_t version;
+  uint32_t function_record_size;
+  uint32_t argument_record_size;
+  uint32_t nb_functions;
+  uint32_t nb_arguments;
+  uint32_t nb_buckets;
+  const uint32_t *seeds;
+  const _vfi_profile_function_t *functions;
+  const _vfi_profile_argument_t *arguments;
+  const uint64_t *histograms;
+  const char *strings;
+} _vfi_profile_t;
+
+"""
+
+
+def generate(functions, source):
+    ids = [function.id for function in functions]
+    nb_buckets, seeds, order = vfi_profile.build_mph(ids)
+    strings = vfi_profile.StringTable()
+
+    function_records = []
+    argument_records = []
+    histogram_records = []
+    for slot in range(len(functions)):
+        function = functions[order[slot]]
+        first_arg = len(argument_records)
+        for arg in function.input_args + function.output_args:
+            argument_records.append("  {%d, %d, %d, %d, %d, %d}," % (
+                strings.add(arg.arg_id), arg.data_type, arg.mantissa_length,
+                arg.exponent_length, arg.min_range, arg.max_range))
+            histogram_records.append("  %s," % ", ".join(
+                "%d" % count
+                for count in vfi_profile.histogram_bins(arg.exponent_hist)))
+        function_records.append(
+            "  {%d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d}," % (
+                strings.add(function.id), function.is_library_function,
+                function.is_intrinsic_function, function.use_float,
+                function.use_double, function.ops_prec64,
+                function.ops_range64, function.ops_prec32,
+                function.ops_range32, len(function.input_args),
+                len(function.output_args), first_arg, function.n_calls))
+
+    out = [PREAMBLE % {"source": os.path.basename(source)}]
+    out.append("static const uint32_t seeds[%d] = {\n%s\n};\n\n" % (
+        nb_buckets, "\n".join("  %d," % seed for seed in seeds)))
+    out.append("static const _vfi_profile_function_t functions[%d] = {\n"
+               "%s\n};\n\n" % (max(1, len(function_records)),
+                               "\n".join(function_records)))
+    out.append("static const _vfi_profile_argument_t arguments[%d] = {\n"
+               "%s\n};\n\n" % (max(1, len(argument_records)),
+                               "\n".join(argument_records)))
+    out.append("static const uint64_t histograms[%d] = {\n%s\n};\n\n" % (
+        max(1, len(histogram_records)) * vfi_profile.HIST_BINS,
+        "\n".join(histogram_records)))
+    out.append("static const char strings[] =\n%s;\n\n" %
+               c_string(bytes(strings.data)))
+    out.append(
+        "const _vfi_profile_t vfi_profile = {\n"
+        "  %d, sizeof(_vfi_profile_function_t),\n"
+        "  sizeof(_vfi_profile_argument_t), %d, %d, %d,\n"
+        "  seeds, functions, arguments, histograms, strings};\n" % (
+            vfi_profile.PROFILE_VERSION, len(function_records),
+            len(argument_records), nb_buckets))
+    return "".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compile a VFI profile into a shared object",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__)
+    parser.add_argument("profile", help="text profile")
+    parser.add_argument("-o", "--output", required=True,
+                        help="shared object to generate")
+    parser.add_argument("--emit-c", metavar="FILE",
+                        help="keep the generated C source in FILE")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"),
+                        help="C compiler (default: $CC or cc)")
+    parser.add_argument("--cflags", default="-O1",
+                        help="extra compilation flags")
+    args = parser.parse_args()
+
+    try:
+        source = generate(vfi_profile.load(args.profile), args.profile)
+    except ValueError as error:
+        sys.exit("vfi_compile_profile: %s" % error)
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        c_file = args.emit_c or os.path.join(tmpdir, "profile.c")
+        with open(c_file, "w") as fo:
+            fo.write(source)
+        cmd = shlex.split(args.cc) + shlex.split(args.cflags) + \
+            ["-shared", "-fPIC", "-o", args.output, c_file]
+        sys.exit(subprocess.call(cmd))
+
+
+if __name__ == "__main__":
+    main()
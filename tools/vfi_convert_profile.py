@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+#############################################################################
+#                                                                           #
+#  This file is part of the Verificarlo project,                            #
+#  under the Apache License v2.0 with LLVM Exceptions.                      #
+#  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 #
+#  See https://llvm.org/LICENSE.txt for license information.                #
+#                                                                           #
+#  Copyright (c) 2019-2022                                                  #
+#     Verificarlo Contributors                                              #
+#                                                                           #
+#############################################################################
+"""Convert a VFI profile between the text and the binary formats.
+
+The binary format (see interflop_vprec_profile.h) holds the records of the
+profile, a minimal perfect hash over the function ids and an index of the
+functions sorted by id. Passing a binary profile to --prec-input-file lets
+the backend map it in memory and use the records in place, without parsing
+nor compiling it. Both formats hold the same data: conversions are lossless.
+The format of the input profile is detected.
+
+Example:
+  vfi_convert_profile.py profile.vfi -o profile.vfib
+  vfi_convert_profile.py profile.vfib -o profile.vfi
+"""
+
+import argparse
+import sys
+
+import vfi_profile
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Convert a VFI profile between the text and binary "
+                    "formats",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__)
+    parser.add_argument("profile", help="text or binary profile")
+    parser.add_argument("-o", "--output", required=True,
+                        help="profile to write")
+    parser.add_argument("--to", choices=("text", "binary"),
+                        help="format of the output (default: the other "
+                             "format than the input)")
+    args = parser.parse_args()
+
+    try:
+        binary = vfi_profile.is_binary(args.profile)
+        functions = vfi_profile.load(args.profile)
+        to_binary = args.to == "binary" if args.to else not binary
+        vfi_profile.dump(functions, args.output, binary=to_binary)
+    except ValueError as error:
+        sys.exit("vfi_convert_profile: %s" % error)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+#############################################################################
+#                                                                           #
+#  This file is part of the Verificarlo project,                            #
+#  under the Apache License v2.0 with LLVM Exceptions.                      #
+#  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 #
+#  See https://llvm.org/LICENSE.txt for license information.                #
+#                                                                           #
+#  Copyright (c) 2019-2022                                                  #
+#     Verificarlo Contributors                                              #
+#                                                                           #
+#############################################################################
+"""Decode a binary VFI log into the text log.
+
+Binary logs are written by the backend when --prec-log-format=binary is
+given along with --prec-log-file. Their layout is described in
+interflop_vprec_log.h. The decoded text is identical to the log the
+backend writes with --prec-log-format=text.
+
+Example:
+  vfi_log_decode.py run.vfilog -o run.log
+"""
+
+import argparse
+import math
+import struct
+import sys
+
+# keep in sync with interflop_vprec_log.h
+MAGIC = b"VFILOG\0"
+VERSIONS = (1, 2)
+TAG_STRING = 0
+TAG_RESET = 5
+TAG_SYNC = 6
+SYNC = b"VFISYNC"
+# tag, SYNC and offset of the tag
+SYNC_SIZE = 1 + len(SYNC) + 8
+KIND_BLANK, KIND_ENTER, KIND_EXIT, KIND_ARGUMENT = range(4)
+
+# enum FTYPES
+FFLOAT, FDOUBLE, FQUAD, FFLOAT_PTR, FDOUBLE_PTR = range(5)
+
+TYPE_NAMES = {FFLOAT: "float", FDOUBLE: "double", FFLOAT_PTR: "float_ptr",
+              FDOUBLE_PTR: "double_ptr"}
+
+# bytes read at once, and bytes kept available before decoding an entry
+CHUNK_SIZE = 1 << 20
+ENTRY_MAX = 4096
+
+
+def c_hex(bits):
+    """Format a binary32 or binary64 value given as little-endian bytes
+    like the %a conversion of glibc"""
+    if len(bits) == 8:
+        value = struct.unpack("<d", bits)[0]
+    else:
+        value = struct.unpack("<f", bits)[0]
+    if math.isnan(value):
+        return "-nan" if bits[-1] >> 7 else "nan"
+    if math.isinf(value):
+        return "-inf" if value < 0 else "inf"
+    mantissa, exponent = value.hex().split("p")
+    return mantissa.rstrip("0").rstrip(".") + "p" + exponent
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+def read_svarint(data, pos):
+    value, pos = read_varint(data, pos)
+    return (value >> 1) ^ -(value & 1), pos
+
+
+def read_bytes(data, pos, size):
+    if pos + size > len(data):
+        raise IndexError("truncated entry")
+    return data[pos:pos + size], pos + size
+
+
+class Decoder:
+    def __init__(self, out):
+        self.out = out
+        self.strings = []
+        self.depth = 0
+
+    def decode_entry(self, data, pos):
+        """Decode the entry at pos and return the position of the next one.
+        Raise IndexError, without any effect, if the entry is incomplete"""
+        tag = data[pos]
+        pos += 1
+        if tag == TAG_STRING:
+            length, pos = read_varint(data, pos)
+            string, pos = read_bytes(data, pos, length)
+            self.strings.append(string.decode())
+            return pos
+        if tag == TAG_RESET:
+            self.strings = []
+            self.depth = 0
+            return pos
+        if tag == TAG_SYNC:
+            _, pos = read_bytes(data, pos, SYNC_SIZE - 1)
+            self.strings = []
+            self.depth = 0
+            return pos
+
+        kind = (tag & 0x7) - 1
+        type = (tag >> 3) & 0x7
+        is_input = (tag >> 6) & 1
+        is_null = tag >> 7
+        delta, pos = read_svarint(data, pos)
+        depth = self.depth + delta
+        tabs = "\t" * depth
+
+        if kind == KIND_BLANK:
+            line = tabs + "\n"
+        elif kind in (KIND_ENTER, KIND_EXIT):
+            function, pos = read_varint(data, pos)
+            lengths = []
+            for _ in range(4):
+                length, pos = read_svarint(data, pos)
+                lengths.append(length)
+            line = "%s%s %s\t%d\t%d\t%d\t%d\n" % (
+                tabs, "enter in" if kind == KIND_ENTER else "exit of",
+                self.strings[function], *lengths)
+        elif kind == KIND_ARGUMENT:
+            line, pos = self.decode_argument(data, pos, tabs, type, is_input,
+                                             is_null)
+        else:
+            raise ValueError("invalid tag %#x at offset %d" % (tag, pos - 1))
+
+        self.depth = depth
+        self.out.write(line)
+        return pos
+
+    def decode_argument(self, data, pos, tabs, type, is_input, is_null):
+        function, pos = read_varint(data, pos)
+        arg_id, pos = read_varint(data, pos)
+        name = "%s\t%s" % (self.strings[function],
+                           "input" if is_input else "output")
+        if type in (FFLOAT_PTR, FDOUBLE_PTR):
+            index, pos = read_varint(data, pos)
+            name += "[%d]" % index
+        head = "%s - %s\t%s\t%s\t" % (tabs, name, TYPE_NAMES[type],
+                                      self.strings[arg_id])
+        if is_null:
+            return head + "NULL\t->\tNULL\n", pos
+
+        mantissa_length, pos = read_svarint(data, pos)
+        exponent_length, pos = read_svarint(data, pos)
+        size = 8 if type in (FDOUBLE, FDOUBLE_PTR) else 4
+        before, pos = read_bytes(data, pos, size)
+        after, pos = read_bytes(data, pos, size)
+        # binary64 outputs have always been logged without the space
+        separator = "," if size == 8 and not is_input else ", "
+        return "%s%s\t->\t%s%s\t(%d%s%d)\n" % (
+            head, c_hex(before), tabs, c_hex(after), mantissa_length,
+            separator, exponent_length), pos
+
+
+def decode(stream, out):
+    header = stream.read(len(MAGIC) + 1)
+    if header[:len(MAGIC)] != MAGIC:
+        raise ValueError("not a binary VFI log")
+    if header[len(MAGIC)] not in VERSIONS:
+        raise ValueError("unsupported binary VFI log version %d" %
+                         header[len(MAGIC)])
+
+    decoder = Decoder(out)
+    data = b""
+    pos = 0
+    eof = False
+    while True:
+        if len(data) - pos < ENTRY_MAX and not eof:
+            chunk = stream.read(CHUNK_SIZE)
+            eof = not chunk
+            data = data[pos:] + chunk
+            pos = 0
+        if pos == len(data):
+            return
+        try:
+            pos = decoder.decode_entry(data, pos)
+        except IndexError:
+            if eof:
+                raise ValueError("truncated binary VFI log")
+            # entry larger than ENTRY_MAX, read more
+            chunk = stream.read(CHUNK_SIZE)
+            eof = not chunk
+            data = data[pos:] + chunk
+            pos = 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Decode a binary VFI log into the text log",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__)
+    parser.add_argument("log", help="binary log")
+    parser.add_argument("-o", "--output",
+                        help="text log to write (default: standard output)")
+    args = parser.parse_args()
+
+    with open(args.log, "rb") as fi:
+        if args.output:
+            with open(args.output, "w") as fo:
+                decode(fi, fo)
+        else:
+            decode(fi, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
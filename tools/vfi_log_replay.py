@@ -0,0 +1,375 @@
+#!/usr/bin/env python3
+#############################################################################
+#                                                                           #
+#  This file is part of the Verificarlo project,                            #
+#  under the Apache License v2.0 with LLVM Exceptions.                      #
+#  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 #
+#  See https://llvm.org/LICENSE.txt for license information.                #
+#                                                                           #
+#  Copyright (c) 2019-2022                                                  #
+#     Verificarlo Contributors                                              #
+#                                                                           #
+#############################################################################
+"""Rebuild the VFI profile of a run from its log.
+
+The log written with --prec-log-file, text or binary, is split in chunks
+replayed by parallel processes. The number of calls, the internal
+operations precisions and the argument lengths, ranges and exponent
+histograms are the ones _vfi_write_hasmap writes at the end of the run.
+Text logs are split at line boundaries and binary logs at their sync
+entries (see interflop_vprec_log.h).
+
+The log must hold every call: it must be written without
+--instrument-sample and without the --prec-log-* filters. When the run
+read a profile with --prec-input-file, give it with --input-profile: its
+statistics are accumulated as the backend does. The fields that are not
+logged (library and intrinsic flags, floating point instruction counters)
+are taken from this profile and are 0 for the other functions. Arguments
+never logged, such as pointers of size 0, are missing.
+
+The run itself can skip the range tracking with --instrument-no-ranges:
+its arguments are still rounded and logged, and the ranges are computed
+here on other cores.
+
+Example:
+  vfi_log_replay.py run.log -o profile.vfi
+  vfi_log_replay.py run.vfilog --input-profile in.vfi -o out.vfi -j 16
+"""
+
+import argparse
+import math
+import mmap
+import multiprocessing
+import os
+import struct
+import sys
+
+import vfi_log_decode
+import vfi_profile
+from vfi_log_decode import read_svarint, read_varint
+
+INT_MAX = 2**31 - 1
+INT_MIN = -2**31
+
+# chunks replayed per process, for load balancing
+CHUNKS_PER_JOB = 4
+# smallest chunk, in bytes
+CHUNK_MIN = 1 << 20
+
+TYPE_IDS = {name: type for type, name in vfi_log_decode.TYPE_NAMES.items()}
+POINTER_TYPES = (vfi_log_decode.FFLOAT_PTR, vfi_log_decode.FDOUBLE_PTR)
+BINARY64_TYPES = (vfi_log_decode.FDOUBLE, vfi_log_decode.FDOUBLE_PTR)
+
+# default lengths of the arguments, see _vfi_init_argument
+BINARY64_LENGTHS = (52, 11)
+BINARY32_LENGTHS = (23, 8)
+
+
+class Statistics:
+    """Functions and arguments seen in a chunk, each is given the position
+    of its first record to restore the order of the arguments"""
+
+    def __init__(self, chunk):
+        self.chunk = chunk
+        self.seq = 0
+        # id -> [position, n_calls, ops lengths, arguments]
+        self.functions = {}
+
+    def function(self, id):
+        function = self.functions.get(id)
+        if function is None:
+            function = [(self.chunk, self.seq), 0, None, {}]
+            self.functions[id] = function
+            self.seq += 1
+        return function
+
+    def enter(self, id, lengths):
+        function = self.function(id)
+        function[1] += 1
+        function[2] = lengths
+
+    def argument(self, id, is_input, type, arg_id):
+        """Return [position, type, mantissa, exponent, min, max, histogram]
+        of an argument, the lengths are None until a value is logged"""
+        arguments = self.function(id)[3]
+        key = (is_input, arg_id)
+        argument = arguments.get(key)
+        if argument is None:
+            argument = [(self.chunk, self.seq), type, None, None, INT_MAX,
+                        INT_MIN, {}]
+            arguments[key] = argument
+            self.seq += 1
+        return argument
+
+
+def _bound(value):
+    """_vfi_range_bound"""
+    return INT_MAX if value >= INT_MAX else INT_MIN if value <= INT_MIN \
+        else value
+
+
+def count(argument, value):
+    """Update the range and the histogram of argument with a value after
+    rounding, like _vfi_round_binary64/32"""
+    if math.isnan(value) or math.isinf(value):
+        return
+    histogram = argument[6]
+    if value == 0:
+        bin = vfi_profile.ZERO_BIN
+    else:
+        exponent = math.frexp(value)[1] - 1
+        bin = abs(exponent).bit_length()
+        if exponent < 0:
+            bin = -bin
+    histogram[bin] = histogram.get(bin, 0) + 1
+    if value < argument[4]:
+        argument[4] = _bound(math.floor(value))
+    if value > argument[5]:
+        argument[5] = _bound(math.ceil(value))
+
+
+def replay_text(data, chunk):
+    statistics = Statistics(chunk)
+    for line in data.decode().splitlines():
+        line = line.lstrip("\t")
+        if line.startswith(" - "):
+            left, right = line.split("\t->\t", 1)
+            tokens = left.split("\t")
+            argument = statistics.argument(tokens[0][3:],
+                                           tokens[1].startswith("input"),
+                                           TYPE_IDS[tokens[2]], tokens[3])
+            right = right.lstrip("\t")
+            if right == "NULL":
+                continue
+            after, lengths = right.split("\t(")
+            mantissa, exponent = lengths.rstrip(")").split(",")
+            argument[2] = int(mantissa)
+            argument[3] = int(exponent)
+            count(argument, float.fromhex(after))
+        elif line.startswith("enter in "):
+            tokens = line.split("\t")
+            statistics.enter(tokens[0][len("enter in "):],
+                             tuple(int(token) for token in tokens[1:5]))
+    return statistics
+
+
+def replay_binary(data, pos, end, chunk):
+    statistics = Statistics(chunk)
+    strings = []
+    while pos < end:
+        tag = data[pos]
+        pos += 1
+        if tag == vfi_log_decode.TAG_STRING:
+            length, pos = read_varint(data, pos)
+            strings.append(bytes(data[pos:pos + length]).decode())
+            pos += length
+            continue
+        if tag in (vfi_log_decode.TAG_RESET, vfi_log_decode.TAG_SYNC):
+            if tag == vfi_log_decode.TAG_SYNC:
+                pos += vfi_log_decode.SYNC_SIZE - 1
+            strings = []
+            continue
+
+        kind = (tag & 0x7) - 1
+        type = (tag >> 3) & 0x7
+        _, pos = read_svarint(data, pos)
+        if kind in (vfi_log_decode.KIND_ENTER, vfi_log_decode.KIND_EXIT):
+            function, pos = read_varint(data, pos)
+            lengths = []
+            for _ in range(4):
+                length, pos = read_svarint(data, pos)
+                lengths.append(length)
+            if kind == vfi_log_decode.KIND_ENTER:
+                statistics.enter(strings[function], tuple(lengths))
+        elif kind == vfi_log_decode.KIND_ARGUMENT:
+            function, pos = read_varint(data, pos)
+            arg_id, pos = read_varint(data, pos)
+            if type in POINTER_TYPES:
+                _, pos = read_varint(data, pos)
+            argument = statistics.argument(strings[function], (tag >> 6) & 1,
+                                           type, strings[arg_id])
+            if tag >> 7:
+                continue
+            argument[2], pos = read_svarint(data, pos)
+            argument[3], pos = read_svarint(data, pos)
+            if type in BINARY64_TYPES:
+                value = struct.unpack_from("<d", data, pos + 8)[0]
+                pos += 16
+            else:
+                value = struct.unpack_from("<f", data, pos + 4)[0]
+                pos += 8
+            count(argument, value)
+        elif kind != vfi_log_decode.KIND_BLANK:
+            raise ValueError("invalid tag %#x at offset %d" % (tag, pos - 1))
+    if pos != end:
+        raise ValueError("entry across the chunk boundary at offset %d" % end)
+    return statistics
+
+
+def is_binary(data):
+    return data[:len(vfi_log_decode.MAGIC)] == vfi_log_decode.MAGIC
+
+
+def _is_sync(data, pos):
+    """True if a sync entry starts at pos: its offset is checked so that
+    the bits of a value can't be taken for a sync entry"""
+    offset = pos + vfi_log_decode.SYNC_SIZE - 8
+    return offset + 8 <= len(data) and \
+        struct.unpack_from("<Q", data, offset)[0] == pos
+
+
+def _next_sync(data, pos):
+    pattern = bytes([vfi_log_decode.TAG_SYNC]) + vfi_log_decode.SYNC
+    while True:
+        pos = data.find(pattern, pos)
+        if pos == -1:
+            return len(data)
+        if _is_sync(data, pos):
+            return pos
+        pos += 1
+
+
+def _next_line(data, pos):
+    pos = data.find(b"\n", pos - 1)
+    return len(data) if pos == -1 else pos + 1
+
+
+def split(data, nb_chunks):
+    """Return the (start, end) offsets of the chunks of a log"""
+    binary = is_binary(data)
+    first = len(vfi_log_decode.MAGIC) + 1 if binary else 0
+    size = max((len(data) - first) // nb_chunks, CHUNK_MIN)
+    boundary = _next_sync if binary else _next_line
+    bounds = [first]
+    for pos in range(first + size, len(data), size):
+        pos = boundary(data, pos)
+        if pos > bounds[-1]:
+            bounds.append(pos)
+    if bounds[-1] < len(data):
+        bounds.append(len(data))
+    return list(zip(bounds[:-1], bounds[1:]))
+
+
+def _replay_chunk(task):
+    path, chunk, start, end = task
+    with open(path, "rb") as fi:
+        with mmap.mmap(fi.fileno(), 0, access=mmap.ACCESS_READ) as data:
+            if is_binary(data):
+                return replay_binary(data, start, end, chunk)
+            return replay_text(data[start:end], chunk)
+
+
+def replay(path, jobs):
+    """Replay the log in parallel and return the Statistics of its chunks"""
+    if os.path.getsize(path) == 0:
+        return []
+    with open(path, "rb") as fi:
+        with mmap.mmap(fi.fileno(), 0, access=mmap.ACCESS_READ) as data:
+            if is_binary(data) and \
+                    data[len(vfi_log_decode.MAGIC)] not in \
+                    vfi_log_decode.VERSIONS:
+                raise ValueError("unsupported binary VFI log version %d" %
+                                 data[len(vfi_log_decode.MAGIC)])
+            chunks = split(data, jobs * CHUNKS_PER_JOB)
+
+    tasks = [(path, chunk, start, end)
+             for chunk, (start, end) in enumerate(chunks)]
+    if jobs == 1 or len(tasks) == 1:
+        return [_replay_chunk(task) for task in tasks]
+    with multiprocessing.Pool(jobs) as pool:
+        return pool.map(_replay_chunk, tasks)
+
+
+def _merge_argument(argument, merged):
+    """Merge the statistics of an argument in a vfi_profile.Argument"""
+    if merged[2] is not None:
+        argument.mantissa_length = merged[2]
+        argument.exponent_length = merged[3]
+    argument.min_range = min(argument.min_range, merged[4])
+    argument.max_range = max(argument.max_range, merged[5])
+    for bin, count in merged[6].items():
+        argument.exponent_hist[bin] = argument.exponent_hist.get(bin, 0) + \
+            count
+
+
+def merge(chunks, profile=()):
+    """Merge the statistics of the chunks in order with the functions of
+    the input profile, return the functions sorted by id"""
+    functions = {function.id: function.copy() for function in profile}
+    merged = {}
+    for statistics in chunks:
+        for id, (position, n_calls, lengths, arguments) in \
+                statistics.functions.items():
+            function = merged.setdefault(id, [position, 0, None, {}])
+            function[1] += n_calls
+            function[2] = lengths or function[2]
+            for key, argument in arguments.items():
+                if key not in function[3]:
+                    function[3][key] = argument
+                    continue
+                total = function[3][key]
+                if argument[2] is not None:
+                    total[2:4] = argument[2:4]
+                total[4] = min(total[4], argument[4])
+                total[5] = max(total[5], argument[5])
+                for bin, count in argument[6].items():
+                    total[6][bin] = total[6].get(bin, 0) + count
+
+    for id, (_, n_calls, lengths, arguments) in merged.items():
+        function = functions.get(id)
+        if function is None:
+            function = vfi_profile.Function(id)
+            functions[id] = function
+        function.n_calls += n_calls
+        if lengths is not None:
+            (function.ops_prec64, function.ops_range64, function.ops_prec32,
+             function.ops_range32) = lengths
+
+        # arguments are matched by id, the new ones are in order of
+        # appearance in the log
+        for key, argument in sorted(arguments.items(),
+                                    key=lambda item: item[1][0]):
+            is_input, arg_id = key
+            args = function.input_args if is_input else function.output_args
+            known = [arg for arg in args if arg.arg_id == arg_id]
+            if known:
+                _merge_argument(known[0], argument)
+            else:
+                binary64 = argument[1] in BINARY64_TYPES
+                arg = vfi_profile.Argument(
+                    arg_id, argument[1],
+                    *(BINARY64_LENGTHS if binary64 else BINARY32_LENGTHS),
+                    INT_MAX, INT_MIN)
+                _merge_argument(arg, argument)
+                args.append(arg)
+
+    return [functions[id] for id in sorted(functions)]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Rebuild the VFI profile of a run from its log",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__)
+    parser.add_argument("log", help="text or binary log")
+    parser.add_argument("-o", "--output", required=True,
+                        help="profile to write")
+    parser.add_argument("--input-profile",
+                        help="profile read by the run with --prec-input-file")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(),
+                        help="number of processes (default: %(default)s)")
+    args = parser.parse_args()
+
+    if args.jobs < 1:
+        parser.error("--jobs must be a positive integer")
+    profile = vfi_profile.load(args.input_profile) \
+        if args.input_profile else []
+    try:
+        chunks = replay(args.log, args.jobs)
+    except ValueError as error:
+        sys.exit("%s: %s" % (args.log, error))
+    vfi_profile.dump(merge(chunks, profile), args.output)
+
+
+if __name__ == "__main__":
+    main()
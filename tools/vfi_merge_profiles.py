@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+#############################################################################
+#                                                                           #
+#  This file is part of the Verificarlo project,                            #
+#  under the Apache License v2.0 with LLVM Exceptions.                      #
+#  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 #
+#  See https://llvm.org/LICENSE.txt for license information.                #
+#                                                                           #
+#  Copyright (c) 2019-2022                                                  #
+#     Verificarlo Contributors                                              #
+#                                                                           #
+#############################################################################
+"""Merge the VFI profiles of the processes of a run into one profile.
+
+Each process writes its own profile when --prec-output-file holds %r (the
+MPI rank) or %p (the pid). The merged profile can be given back to
+--prec-input-file:
+
+  - the numbers of calls are summed;
+  - the argument ranges are united and the exponent histograms summed;
+  - the precisions and ranges of the operations and of the arguments are
+    the largest ones of the profiles;
+  - arguments are matched by position, as the backend does. A function
+    gets the longest argument list recorded for it. When the id or type
+    of an argument differs between profiles, the first one is kept and
+    the difference is reported.
+
+Groups of profiles are loaded and merged by parallel processes, then the
+partial profiles are merged in order: the result doesn't depend on the
+number of processes. Text and binary profiles can be mixed. Arguments
+that are not files are expanded as shell patterns, and @FILE reads
+arguments from FILE, one per line.
+
+Example:
+  vfi_merge_profiles.py 'profile.*.vfi' -o merged.vfi -j 16
+  vfi_merge_profiles.py @profiles.txt -o merged.vfib --to binary
+"""
+
+import argparse
+import glob
+import multiprocessing
+import os
+import sys
+
+import vfi_profile
+
+# groups of profiles merged per process, for load balancing
+GROUPS_PER_JOB = 4
+
+
+def merge_argument(merged, argument):
+    merged.mantissa_length = max(merged.mantissa_length,
+                                 argument.mantissa_length)
+    merged.exponent_length = max(merged.exponent_length,
+                                 argument.exponent_length)
+    merged.min_range = min(merged.min_range, argument.min_range)
+    merged.max_range = max(merged.max_range, argument.max_range)
+    for bin, count in argument.exponent_hist.items():
+        merged.exponent_hist[bin] = merged.exponent_hist.get(bin, 0) + count
+
+
+def merge_arguments(function, kind, merged, arguments):
+    for i, argument in enumerate(arguments):
+        if i == len(merged):
+            merged.append(argument)
+        elif (merged[i].arg_id, merged[i].data_type) != \
+                (argument.arg_id, argument.data_type):
+            print("vfi_merge_profiles: %s argument %d of %s is %s of type %d "
+                  "and %s of type %d, keeping the first one" % (
+                      kind, i, function.id, merged[i].arg_id,
+                      merged[i].data_type, argument.arg_id,
+                      argument.data_type),
+                  file=sys.stderr)
+        else:
+            merge_argument(merged[i], argument)
+
+
+def merge_function(merged, function):
+    merged.is_library_function = max(merged.is_library_function,
+                                     function.is_library_function)
+    merged.is_intrinsic_function = max(merged.is_intrinsic_function,
+                                       function.is_intrinsic_function)
+    merged.use_float = max(merged.use_float, function.use_float)
+    merged.use_double = max(merged.use_double, function.use_double)
+    merged.ops_prec64 = max(merged.ops_prec64, function.ops_prec64)
+    merged.ops_range64 = max(merged.ops_range64, function.ops_range64)
+    merged.ops_prec32 = max(merged.ops_prec32, function.ops_prec32)
+    merged.ops_range32 = max(merged.ops_range32, function.ops_range32)
+    merged.n_calls += function.n_calls
+    merge_arguments(merged, "input", merged.input_args, function.input_args)
+    merge_arguments(merged, "output", merged.output_args,
+                    function.output_args)
+
+
+def merge(profiles):
+    """Merge the lists of functions of profiles in order, return the list
+    of merged functions sorted by id"""
+    merged = {}
+    for functions in profiles:
+        for function in functions:
+            known = merged.get(function.id)
+            if known is None:
+                merged[function.id] = function
+            else:
+                merge_function(known, function)
+    return [merged[id] for id in sorted(merged)]
+
+
+def _merge_group(paths):
+    return merge(vfi_profile.load(path) for path in paths)
+
+
+def merge_files(paths, jobs):
+    """Merge the profiles of paths in parallel"""
+    nb_groups = min(len(paths), jobs * GROUPS_PER_JOB)
+    if jobs == 1 or nb_groups <= 1:
+        return _merge_group(paths)
+    groups = [paths[len(paths) * k // nb_groups:
+                    len(paths) * (k + 1) // nb_groups]
+              for k in range(nb_groups)]
+    with multiprocessing.Pool(jobs) as pool:
+        return merge(pool.map(_merge_group, groups))
+
+
+def expand(patterns):
+    paths = []
+    for pattern in patterns:
+        if os.path.exists(pattern):
+            paths.append(pattern)
+            continue
+        matches = sorted(glob.glob(pattern))
+        if not matches:
+            raise ValueError("no profile matches %s" % pattern)
+        paths += matches
+    return paths
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Merge the VFI profiles of the processes of a run",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        fromfile_prefix_chars="@",
+        epilog=__doc__)
+    parser.add_argument("profiles", nargs="+",
+                        help="text or binary profiles, or their patterns")
+    parser.add_argument("-o", "--output", required=True,
+                        help="profile to write")
+    parser.add_argument("--to", choices=("text", "binary"), default="text",
+                        help="format of the output (default: %(default)s)")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(),
+                        help="number of processes (default: %(default)s)")
+    args = parser.parse_args()
+
+    if args.jobs < 1:
+        parser.error("--jobs must be a positive integer")
+    try:
+        functions = merge_files(expand(args.profiles), args.jobs)
+        vfi_profile.dump(functions, args.output, binary=args.to == "binary")
+    except ValueError as error:
+        sys.exit("vfi_merge_profiles: %s" % error)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,432 @@
+#!/usr/bin/env python3
+#############################################################################
+#                                                                           #
+#  This file is part of the Verificarlo project,                            #
+#  under the Apache License v2.0 with LLVM Exceptions.                      #
+#  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 #
+#  See https://llvm.org/LICENSE.txt for license information.                #
+#                                                                           #
+#  Copyright (c) 2019-2022                                                  #
+#     Verificarlo Contributors                                              #
+#                                                                           #
+#############################################################################
+"""Reader and writer for the VPREC function instrumentation (VFI) profiles.
+
+The text format is the one written by _vfi_write_hasmap and read by
+_vfi_read_hasmap: one tab-separated header line per function followed by
+one line per input argument and one line per output argument.
+
+The last field of an argument line is the exponent histogram of its finite
+values: comma-separated bin:count pairs where bin z counts the zeros and
+bin b the values whose unbiased exponent has |b| bits and the sign of b,
+or - if no value was seen. Profiles without this field are accepted.
+
+The binary format (see interflop_vprec_profile.h) holds the same data in
+fixed-size records, with a minimal perfect hash over the function ids, and
+is mapped in memory by the backend. load detects the format of a profile.
+"""
+
+import collections
+import hashlib
+import struct
+
+HEADER_FIELDS = 12
+ARGUMENT_FIELDS = 8
+
+# key of the bin of zeros in Argument.exponent_hist
+ZERO_BIN = "z"
+
+# data types of enum FTYPES
+FDOUBLE = 1
+FDOUBLE_PTR = 4
+
+# smallest exponent length accepted by VPREC
+RANGE_MIN = 2
+
+# keep in sync with interflop_vprec_profile.h
+PROFILE_VERSION = 2
+PROFILE_MAGIC = b"VFIPROF\0"
+HIST_BINS = 24
+# index of the bin of zeros and of the bin 0 in the binary histograms
+HIST_ZERO = 0
+HIST_OFFSET = 12
+
+# records in the byte order of the machine, without padding
+FILE_HEADER = struct.Struct("=8s6I7Q")
+FUNCTION_RECORD = struct.Struct("=I2h2q6iIi")
+ARGUMENT_RECORD = struct.Struct("=I5i")
+HISTOGRAM_RECORD = struct.Struct("=%dQ" % HIST_BINS)
+
+FNV_OFFSET_BASIS = 0xcbf29ce484222325
+FNV_PRIME = 0x100000001b3
+GOLDEN_RATIO = 0x9e3779b97f4a7c15
+MASK64 = (1 << 64) - 1
+
+# average number of ids per bucket of the minimal perfect hash
+BUCKET_SIZE = 3
+# seeds are stored as uint32_t; a bucket tries at most SEEDS_PER_ID * n of
+# them before the displacement table grows. The last buckets placed need about
+# n tries each to hit one of the few free slots.
+MAX_SEED = (1 << 32) - 1
+SEEDS_PER_ID = 64
+MAX_BUCKETS_PER_ID = 4
+
+
+def _parse_histogram(token):
+    histogram = {}
+    if token == "-":
+        return histogram
+    for pair in token.split(","):
+        bin, count = pair.split(":")
+        histogram[bin if bin == ZERO_BIN else int(bin)] = int(count)
+    return histogram
+
+
+def _dump_histogram(histogram):
+    pairs = ["%s:%d" % (bin, count)
+             for bin, count in sorted(histogram.items(),
+                                      key=lambda item: (item[0] != ZERO_BIN,
+                                                        item[0] != ZERO_BIN
+                                                        and item[0]))
+             if count]
+    return ",".join(pairs) or "-"
+
+
+class Argument:
+    __slots__ = ("arg_id", "data_type", "mantissa_length", "exponent_length",
+                 "min_range", "max_range", "exponent_hist")
+
+    def __init__(self, arg_id, data_type, mantissa_length, exponent_length,
+                 min_range, max_range, exponent_hist=None):
+        self.arg_id = arg_id
+        self.data_type = data_type
+        self.mantissa_length = mantissa_length
+        self.exponent_length = exponent_length
+        self.min_range = min_range
+        self.max_range = max_range
+        self.exponent_hist = dict(exponent_hist or {})
+
+    def copy(self):
+        return Argument(self.arg_id, self.data_type, self.mantissa_length,
+                        self.exponent_length, self.min_range, self.max_range,
+                        self.exponent_hist)
+
+    def dumps(self, kind):
+        return "%s:\t%s\t%d\t%d\t%d\t%d\t%d\t%s\n" % (
+            kind, self.arg_id, self.data_type, self.mantissa_length,
+            self.exponent_length, self.min_range, self.max_range,
+            _dump_histogram(self.exponent_hist))
+
+    def min_exponent_length(self):
+        """Smallest exponent length keeping every value seen in the normal
+        range, or None if no value was seen"""
+        binary64 = self.data_type in (FDOUBLE, FDOUBLE_PTR)
+        lengths = [RANGE_MIN]
+        for bin, count in self.exponent_hist.items():
+            if bin == ZERO_BIN or not count:
+                continue
+            # emax = 2^(length-1) - 1 and emin = 2 - 2^(length-1)
+            lengths.append(bin + 1 if bin >= 0 else 2 - bin)
+        if len(lengths) == 1 and not self.exponent_hist.get(ZERO_BIN):
+            return None
+        return min(max(lengths), 11 if binary64 else 8)
+
+
+class Function:
+    __slots__ = ("id", "is_library_function", "is_intrinsic_function",
+                 "use_float", "use_double", "ops_prec64", "ops_range64",
+                 "ops_prec32", "ops_range32", "input_args", "output_args",
+                 "n_calls")
+
+    def __init__(self, id, is_library_function=0, is_intrinsic_function=0,
+                 use_float=0, use_double=0, ops_prec64=52, ops_range64=11,
+                 ops_prec32=23, ops_range32=8, n_calls=0):
+        self.id = id
+        self.is_library_function = is_library_function
+        self.is_intrinsic_function = is_intrinsic_function
+        self.use_float = use_float
+        self.use_double = use_double
+        self.ops_prec64 = ops_prec64
+        self.ops_range64 = ops_range64
+        self.ops_prec32 = ops_prec32
+        self.ops_range32 = ops_range32
+        self.input_args = []
+        self.output_args = []
+        self.n_calls = n_calls
+
+    def copy(self):
+        function = Function(self.id, self.is_library_function,
+                            self.is_intrinsic_function, self.use_float,
+                            self.use_double, self.ops_prec64,
+                            self.ops_range64, self.ops_prec32,
+                            self.ops_range32, self.n_calls)
+        function.input_args = [arg.copy() for arg in self.input_args]
+        function.output_args = [arg.copy() for arg in self.output_args]
+        return function
+
+    def dumps(self):
+        lines = ["%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n" % (
+            self.id, self.is_library_function, self.is_intrinsic_function,
+            self.use_float, self.use_double, self.ops_prec64,
+            self.ops_range64, self.ops_prec32, self.ops_range32,
+            len(self.input_args), len(self.output_args), self.n_calls)]
+        lines += [arg.dumps("input") for arg in self.input_args]
+        lines += [arg.dumps("output") for arg in self.output_args]
+        return "".join(lines)
+
+
+def _parse_argument(line, kind):
+    tokens = line.rstrip("\n").split("\t")
+    if len(tokens) not in (ARGUMENT_FIELDS - 1, ARGUMENT_FIELDS) or \
+            tokens[0] != kind + ":":
+        raise ValueError("malformed %s argument line: %r" % (kind, line))
+    histogram = {}
+    if len(tokens) == ARGUMENT_FIELDS:
+        histogram = _parse_histogram(tokens[7])
+    return Argument(tokens[1], *(int(token) for token in tokens[2:7]),
+                    exponent_hist=histogram)
+
+
+def loads(text):
+    """Parse a profile and return the list of functions in file order"""
+    functions = []
+    lines = iter(text.splitlines(True))
+    for line in lines:
+        if not line.strip():
+            continue
+        tokens = line.rstrip("\n").split("\t")
+        if len(tokens) != HEADER_FIELDS:
+            raise ValueError("malformed function header: %r" % line)
+        values = [int(token) for token in tokens[1:]]
+        function = Function(tokens[0], *values[:8], n_calls=values[10])
+        function.input_args = [_parse_argument(next(lines), "input")
+                               for _ in range(values[8])]
+        function.output_args = [_parse_argument(next(lines), "output")
+                                for _ in range(values[9])]
+        functions.append(function)
+    return functions
+
+
+def fnv1a(id):
+    hash = FNV_OFFSET_BASIS
+    for c in id.encode():
+        hash = ((hash ^ c) * FNV_PRIME) & MASK64
+    return hash
+
+
+def mix(z):
+    z ^= z >> 30
+    z = (z * 0xbf58476d1ce4e5b9) & MASK64
+    z ^= z >> 27
+    z = (z * 0x94d049bb133111eb) & MASK64
+    z ^= z >> 31
+    return z
+
+
+def _displace(hashes, nb_buckets):
+    """Find a seed for each bucket so that the ids land on distinct slots.
+    Return (seeds, order), or None when a bucket exhausts its seeds"""
+    n = len(hashes)
+    nb_seeds = min(MAX_SEED, SEEDS_PER_ID * n)
+    buckets = [[] for _ in range(nb_buckets)]
+    for i, hash in enumerate(hashes):
+        buckets[mix(hash) % nb_buckets].append(i)
+
+    seeds = [0] * nb_buckets
+    order = [None] * n
+    for bucket in sorted(range(nb_buckets), key=lambda b: -len(buckets[b])):
+        keys = buckets[bucket]
+        if not keys:
+            break
+        for seed in range(nb_seeds):
+            slots = [mix(hashes[i] ^ ((seed * GOLDEN_RATIO) & MASK64)) % n
+                     for i in keys]
+            if len(set(slots)) == len(slots) and \
+                    all(order[slot] is None for slot in slots):
+                break
+        else:
+            return None
+        seeds[bucket] = seed
+        for i, slot in zip(keys, slots):
+            order[slot] = i
+    return seeds, order
+
+
+def build_mph(ids):
+    """Hash and displace: return (nb_buckets, seeds, order) where order[slot]
+    is the index in ids of the id stored at slot, as _vfi_mph_lookup
+    expects"""
+    duplicates = sorted(id for id, count in collections.Counter(ids).items()
+                        if count > 1)
+    if duplicates:
+        raise ValueError("duplicate function ids: %s" % ", ".join(duplicates))
+
+    n = len(ids)
+    hashes = [fnv1a(id) for id in ids]
+    if len(set(hashes)) != n:
+        raise ValueError("hash collision between function ids")
+
+    # smaller buckets are easier to place: grow the displacement table when
+    # a bucket runs out of seeds instead of searching forever
+    nb_buckets = max(1, (n + BUCKET_SIZE - 1) // BUCKET_SIZE)
+    while nb_buckets <= MAX_BUCKETS_PER_ID * n:
+        mph = _displace(hashes, nb_buckets)
+        if mph is not None:
+            return (nb_buckets,) + mph
+        nb_buckets *= 2
+    raise ValueError("no perfect hash found for %d ids" % n)
+
+
+class StringTable:
+    def __init__(self):
+        self.offsets = {}
+        self.data = bytearray()
+
+    def add(self, string):
+        if string not in self.offsets:
+            self.offsets[string] = len(self.data)
+            self.data += string.encode() + b"\0"
+        return self.offsets[string]
+
+
+def histogram_bins(histogram):
+    """Exponent histogram as the HIST_BINS counts of the backend"""
+    bins = [0] * HIST_BINS
+    for bin, count in histogram.items():
+        bins[HIST_ZERO if bin == ZERO_BIN else bin + HIST_OFFSET] += count
+    return bins
+
+
+def _histogram_dict(bins):
+    return {ZERO_BIN if i == HIST_ZERO else i - HIST_OFFSET: count
+            for i, count in enumerate(bins) if count}
+
+
+def dumps_binary(functions):
+    """Return the binary profile of a list of functions"""
+    nb_buckets, seeds, order = build_mph([function.id
+                                          for function in functions])
+    strings = StringTable()
+    function_records = bytearray()
+    argument_records = bytearray()
+    histogram_records = bytearray()
+    nb_arguments = 0
+    for slot in range(len(functions)):
+        function = functions[order[slot]]
+        first_arg = nb_arguments
+        for arg in function.input_args + function.output_args:
+            argument_records += ARGUMENT_RECORD.pack(
+                strings.add(arg.arg_id), arg.data_type, arg.mantissa_length,
+                arg.exponent_length, arg.min_range, arg.max_range)
+            histogram_records += HISTOGRAM_RECORD.pack(
+                *histogram_bins(arg.exponent_hist))
+            nb_arguments += 1
+        function_records += FUNCTION_RECORD.pack(
+            strings.add(function.id), function.is_library_function,
+            function.is_intrinsic_function, function.use_float,
+            function.use_double, function.ops_prec64, function.ops_range64,
+            function.ops_prec32, function.ops_range32,
+            len(function.input_args), len(function.output_args), first_arg,
+            function.n_calls)
+    # the string table is never empty
+    strings.add("")
+    index = sorted(range(len(functions)),
+                   key=lambda slot: functions[order[slot]].id.encode())
+
+    sections = [struct.pack("=%dI" % nb_buckets, *seeds), function_records,
+                argument_records, histogram_records,
+                struct.pack("=%dI" % len(index), *index), strings.data]
+    data = bytearray(FILE_HEADER.size)
+    offsets = []
+    for section in sections:
+        data += bytes(-len(data) % 8)
+        offsets.append(len(data))
+        data += section
+    FILE_HEADER.pack_into(data, 0, PROFILE_MAGIC, PROFILE_VERSION,
+                          FUNCTION_RECORD.size, ARGUMENT_RECORD.size,
+                          len(functions), nb_arguments, nb_buckets, *offsets,
+                          len(strings.data))
+    return bytes(data)
+
+
+def loads_binary(data):
+    """Parse a binary profile and return the list of functions in id
+    order"""
+    try:
+        return _loads_binary(data)
+    except (struct.error, IndexError) as error:
+        raise ValueError("truncated binary VFI profile") from error
+
+
+def _loads_binary(data):
+    (magic, version, function_size, argument_size, nb_functions, _, _, _,
+     functions_offset, arguments_offset, histograms_offset, index_offset,
+     strings_offset, _) = FILE_HEADER.unpack_from(data)
+    if magic != PROFILE_MAGIC:
+        raise ValueError("not a binary VFI profile")
+    if version != PROFILE_VERSION or \
+            function_size != FUNCTION_RECORD.size or \
+            argument_size != ARGUMENT_RECORD.size:
+        raise ValueError("unsupported binary VFI profile version %d" %
+                         version)
+
+    def string(offset):
+        start = strings_offset + offset
+        return data[start:data.index(b"\0", start)].decode()
+
+    functions = []
+    for slot in struct.unpack_from("=%dI" % nb_functions, data, index_offset):
+        (id, is_library_function, is_intrinsic_function, use_float,
+         use_double, ops_prec64, ops_range64, ops_prec32, ops_range32,
+         nb_input_args, nb_output_args, first_arg, n_calls) = \
+            FUNCTION_RECORD.unpack_from(
+                data, functions_offset + slot * FUNCTION_RECORD.size)
+        function = Function(string(id), is_library_function,
+                            is_intrinsic_function, use_float, use_double,
+                            ops_prec64, ops_range64, ops_prec32, ops_range32,
+                            n_calls)
+        args = []
+        for i in range(first_arg, first_arg + nb_input_args + nb_output_args):
+            arg_id, *fields = ARGUMENT_RECORD.unpack_from(
+                data, arguments_offset + i * ARGUMENT_RECORD.size)
+            bins = HISTOGRAM_RECORD.unpack_from(
+                data, histograms_offset + i * HISTOGRAM_RECORD.size)
+            args.append(Argument(string(arg_id), *fields,
+                                 exponent_hist=_histogram_dict(bins)))
+        function.input_args = args[:nb_input_args]
+        function.output_args = args[nb_input_args:]
+        functions.append(function)
+    return functions
+
+
+def is_binary(path):
+    with open(path, "rb") as fi:
+        return fi.read(len(PROFILE_MAGIC)) == PROFILE_MAGIC
+
+
+def load(path):
+    """Read a text or binary profile"""
+    with open(path, "rb") as fi:
+        data = fi.read()
+    if data.startswith(PROFILE_MAGIC):
+        return loads_binary(data)
+    return loads(data.decode())
+
+
+def dumps(functions):
+    return "".join(function.dumps() for function in functions)
+
+
+def dump(functions, path, binary=False):
+    if binary:
+        with open(path, "wb") as fo:
+            fo.write(dumps_binary(functions))
+    else:
+        with open(path, "w") as fo:
+            fo.write(dumps(functions))
+
+
+def digest(functions):
+    """Hash identifying a configuration, independent of the function order"""
+    text = "".join(sorted(function.dumps() for function in functions))
+    return hashlib.sha256(text.encode()).hexdigest()
@@ -0,0 +1,322 @@
+#!/usr/bin/env python3
+#############################################################################
+#                                                                           #
+#  This file is part of the Verificarlo project,                            #
+#  under the Apache License v2.0 with LLVM Exceptions.                      #
+#  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception.                 #
+#  See https://llvm.org/LICENSE.txt for license information.                #
+#                                                                           #
+#  Copyright (c) 2019-2022                                                  #
+#     Verificarlo Contributors                                              #
+#                                                                           #
+#############################################################################
+"""Automatic per-function precision tuning for VPREC.
+
+Starting from a profile written with --prec-output-file, the tuner lowers
+OpsPrec64/OpsPrec32 and the arguments mantissa_length of every instrumented
+function and looks for the minimal precision map that still satisfies a
+user-supplied accuracy predicate.
+
+The search has two phases:
+  1. delta debugging finds a 1-minimal set of knobs that must stay at their
+     original precision when every other knob is set to its minimum;
+  2. each remaining knob is bisected between its minimum and its original
+     precision, all knobs concurrently, and the combination is repaired
+     knob by knob if the independently tuned values do not work together.
+
+Candidates are evaluated concurrently on all local cores. Results are cached
+by configuration hash, so identical candidates are never run twice, even
+across invocations of the tuner. The hash covers the run and check commands
+and the baseline profile, changing any of them starts from a fresh verdict.
+
+Example:
+  vfi_tune.py --profile baseline.vfi --jobs 32 \\
+      --run 'VFC_BACKENDS="libinterflop_vprec.so --mode=full \\
+             --instrument=all --prec-input-file={profile}" ./app > out.txt' \\
+      --check 'python3 compare.py out.txt reference.txt' \\
+      --output tuned.vfi
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+from concurrent.futures import ThreadPoolExecutor
+
+import vfi_profile
+
+PRECISION_MIN = 1
+
+
+class Knob:
+    """A tunable precision: (function index, field, argument index)"""
+
+    def __init__(self, function, field, arg=None):
+        self.function = function
+        self.field = field
+        self.arg = arg
+
+    def get(self, functions):
+        function = functions[self.function]
+        if self.field == "ops_prec64":
+            return function.ops_prec64
+        if self.field == "ops_prec32":
+            return function.ops_prec32
+        return getattr(function, self.field)[self.arg].mantissa_length
+
+    def set(self, functions, value):
+        function = functions[self.function]
+        if self.field in ("ops_prec64", "ops_prec32"):
+            setattr(function, self.field, value)
+        else:
+            getattr(function, self.field)[self.arg].mantissa_length = value
+
+    def name(self, functions):
+        function = functions[self.function]
+        if self.arg is None:
+            return "%s:%s" % (function.id, self.field)
+        arg = getattr(function, self.field)[self.arg]
+        return "%s:%s:%s" % (function.id, self.field, arg.arg_id)
+
+
+def find_knobs(functions, tune_ops, tune_args):
+    knobs = []
+    for i, function in enumerate(functions):
+        if function.is_library_function or function.is_intrinsic_function:
+            continue
+        if tune_ops:
+            if function.use_double:
+                knobs.append(Knob(i, "ops_prec64"))
+            if function.use_float:
+                knobs.append(Knob(i, "ops_prec32"))
+        if tune_args:
+            knobs += [Knob(i, "input_args", j)
+                      for j in range(len(function.input_args))]
+            knobs += [Knob(i, "output_args", j)
+                      for j in range(len(function.output_args))]
+    return knobs
+
+
+class Evaluator:
+    """Run candidates concurrently, caching the results by configuration"""
+
+    def __init__(self, args):
+        self.run_cmd = args.run
+        self.check_cmd = args.check
+        self.keep = args.keep_workdirs
+        self.workdir = args.workdir
+        self.cache_path = args.cache
+        # verdicts only hold for the same commands and baseline profile
+        self.context = json.dumps([args.run, args.check,
+                                   os.path.abspath(args.profile)])
+        self.cache = {}
+        self.pending = {}
+        self.lock = threading.Lock()
+        self.pool = ThreadPoolExecutor(max_workers=args.jobs)
+        self.nb_runs = 0
+        if self.cache_path and os.path.exists(self.cache_path):
+            with open(self.cache_path) as fi:
+                self.cache = json.load(fi)
+
+    def _save_cache(self):
+        if not self.cache_path:
+            return
+        tmp = self.cache_path + ".tmp"
+        with open(tmp, "w") as fo:
+            json.dump(self.cache, fo)
+        os.replace(tmp, self.cache_path)
+
+    def key(self, functions):
+        """Cache key of a configuration run with the commands of the tuner"""
+        text = self.context + vfi_profile.digest(functions)
+        return hashlib.sha256(text.encode()).hexdigest()
+
+    def _run(self, key, functions):
+        workdir = tempfile.mkdtemp(prefix="vfi_tune_" + key[:12] + "_",
+                                   dir=self.workdir)
+        profile = os.path.join(workdir, "profile.vfi")
+        vfi_profile.dump(functions, profile)
+        fields = {"profile": profile, "workdir": workdir}
+        ok = subprocess.call(self.run_cmd.format(**fields), shell=True,
+                             cwd=workdir, stdout=subprocess.DEVNULL) == 0
+        if ok and self.check_cmd:
+            ok = subprocess.call(self.check_cmd.format(**fields), shell=True,
+                                 cwd=workdir,
+                                 stdout=subprocess.DEVNULL) == 0
+        if not self.keep:
+            shutil.rmtree(workdir, ignore_errors=True)
+        with self.lock:
+            self.nb_runs += 1
+            self.cache[key] = ok
+            del self.pending[key]
+            self._save_cache()
+        return ok
+
+    def submit(self, functions):
+        """Return a future-like object whose result() is the predicate"""
+        key = self.key(functions)
+        with self.lock:
+            if key in self.cache:
+                return _Done(self.cache[key])
+            if key not in self.pending:
+                functions = [function.copy() for function in functions]
+                self.pending[key] = self.pool.submit(self._run, key,
+                                                     functions)
+            return self.pending[key]
+
+    def evaluate(self, candidates):
+        futures = [self.submit(candidate) for candidate in candidates]
+        return [future.result() for future in futures]
+
+
+class _Done:
+    def __init__(self, value):
+        self.value = value
+
+    def result(self):
+        return self.value
+
+
+def configure(functions, knobs, values):
+    candidate = [function.copy() for function in functions]
+    for knob, value in zip(knobs, values):
+        knob.set(candidate, value)
+    return candidate
+
+
+def ddmin(evaluator, functions, knobs, high, low):
+    """Return a 1-minimal subset of knobs that must keep their high value"""
+
+    def candidate(kept):
+        kept = set(kept)
+        return configure(functions, knobs,
+                         [high[k] if k in kept else low[k]
+                          for k in range(len(knobs))])
+
+    if evaluator.evaluate([candidate([])])[0]:
+        return []
+
+    kept = list(range(len(knobs)))
+    n = 2
+    while len(kept) >= 2:
+        size = len(kept) // n
+        chunks = [kept[i * size:(i + 1) * size] for i in range(n - 1)]
+        chunks.append(kept[(n - 1) * size:])
+        complements = [[k for k in kept if k not in set(chunk)]
+                       for chunk in chunks]
+        subsets = chunks + (complements if n > 2 else [])
+        results = evaluator.evaluate([candidate(s) for s in subsets])
+        reduced = next((s for s, ok in zip(subsets, results) if ok), None)
+        if reduced is not None and reduced in chunks:
+            kept, n = reduced, 2
+        elif reduced is not None:
+            kept, n = reduced, max(n - 1, 2)
+        elif n < len(kept):
+            n = min(2 * n, len(kept))
+        else:
+            break
+    return kept
+
+
+def bisect(evaluator, functions, knobs, values, k, low):
+    """Smallest value of knob k in [low, values[k]] keeping the others"""
+    lo, hi = low, values[k]
+    while lo < hi:
+        mid = (lo + hi) // 2
+        trial = list(values)
+        trial[k] = mid
+        if evaluator.evaluate([configure(functions, knobs, trial)])[0]:
+            hi = mid
+        else:
+            lo = mid + 1
+    return hi
+
+
+def tune(evaluator, functions, knobs, jobs):
+    high = [knob.get(functions) for knob in knobs]
+    low = [PRECISION_MIN] * len(knobs)
+
+    if not evaluator.evaluate([functions])[0]:
+        sys.exit("vfi_tune: the original profile does not satisfy the "
+                 "predicate")
+
+    kept = ddmin(evaluator, functions, knobs, high, low)
+    values = [high[k] if k in set(kept) else low[k]
+              for k in range(len(knobs))]
+    print("vfi_tune: %d/%d knobs must stay above the minimum precision" %
+          (len(kept), len(knobs)), file=sys.stderr)
+
+    # bisect the remaining knobs independently and concurrently
+    with ThreadPoolExecutor(max_workers=jobs) as pool:
+        tuned = list(pool.map(
+            lambda k: bisect(evaluator, functions, knobs, values, k, low[k]),
+            kept))
+
+    combined = list(values)
+    for k, value in zip(kept, tuned):
+        combined[k] = value
+    if evaluator.evaluate([configure(functions, knobs, combined)])[0]:
+        return combined
+
+    # repair: lower the knobs one by one on top of the accumulated values
+    for k, value in zip(kept, tuned):
+        trial = list(values)
+        trial[k] = value
+        if evaluator.evaluate([configure(functions, knobs, trial)])[0]:
+            values = trial
+        else:
+            values[k] = bisect(evaluator, functions, knobs, values, k, value)
+    return values
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Find a minimal per-function precision map",
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__)
+    parser.add_argument("--profile", required=True,
+                        help="profile written with --prec-output-file")
+    parser.add_argument("--run", required=True,
+                        help="shell command running the application; "
+                        "{profile} and {workdir} are substituted")
+    parser.add_argument("--check",
+                        help="shell command deciding if the run is accurate "
+                        "(exit status 0); {profile} and {workdir} are "
+                        "substituted. Without it, the exit status of --run "
+                        "is the predicate")
+    parser.add_argument("--output", default="tuned.vfi",
+                        help="where to write the tuned profile")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(),
+                        help="number of concurrent runs")
+    parser.add_argument("--cache", default="vfi_tune_cache.json",
+                        help="file caching the results by configuration hash")
+    parser.add_argument("--workdir", default=None,
+                        help="directory where the runs are executed")
+    parser.add_argument("--keep-workdirs", action="store_true",
+                        help="do not remove the run directories")
+    parser.add_argument("--no-ops", action="store_true",
+                        help="do not tune OpsPrec64/OpsPrec32")
+    parser.add_argument("--no-args", action="store_true",
+                        help="do not tune the arguments mantissa_length")
+    args = parser.parse_args()
+
+    functions = vfi_profile.load(args.profile)
+    knobs = find_knobs(functions, not args.no_ops, not args.no_args)
+    evaluator = Evaluator(args)
+
+    values = tune(evaluator, functions, knobs, args.jobs)
+    vfi_profile.dump(configure(functions, knobs, values), args.output)
+
+    print("vfi_tune: %d runs, tuned profile written to %s" %
+          (evaluator.nb_runs, args.output), file=sys.stderr)
+    for knob, value in zip(knobs, values):
+        print("%s\t%d" % (knob.name(functions), value))
+
+
+if __name__ == "__main__":
+    main()